@@ -0,0 +1,101 @@
+#include "uspeakcapi.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Drives the C API the way a managed host would: one sender handle encodes (a file or a generated tone),
+// outbound packets are fetched in batches into a single pinned buffer, and a receiver handle decodes each batch in one call.
+
+#define BATCH_PACKETS 16
+#define PACKET_SAMPLES (960 * 3)
+
+static int Check(int32_t status, const char* what)
+{
+    if (status < 0) {
+        printf("%s failed: %d\n", what, status);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    static uint8_t packets[BATCH_PACKETS * USPEAK_CAPI_MAX_PACKET_SIZE];
+    static uint32_t packetSizes[BATCH_PACKETS];
+    static USpeakDecodedPacket decoded[BATCH_PACKETS];
+    static float samples[BATCH_PACKETS * PACKET_SAMPLES];
+    static float tone[48000];
+
+    USpeakHandle* sender = NULL;
+    USpeakHandle* receiver = NULL;
+    USpeakStats stats;
+    size_t framesEncoded = 0;
+    size_t totalPackets = 0;
+    size_t totalSamples = 0;
+    size_t failedPackets = 0;
+    uint32_t packetTime = 0;
+    int batches = 0;
+    int i;
+
+    printf("USpeakNative C API v%d\n", uspeak_api_version());
+
+    if (!Check(uspeak_create(&sender), "uspeak_create") || !Check(uspeak_create(&receiver), "uspeak_create")) {
+        return EXIT_FAILURE;
+    }
+
+    if (argc > 1) {
+        if (!Check(uspeak_stream_file(sender, argv[1]), "uspeak_stream_file")) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        for (i = 0; i < 48000; i++) {
+            tone[i] = 0.25f * (float)sin(2.0 * 3.14159265358979 * 440.0 * i / 48000.0);
+        }
+        if (!Check(uspeak_push_samples(sender, tone, 48000, 48000, 1, &framesEncoded), "uspeak_push_samples")) {
+            return EXIT_FAILURE;
+        }
+        printf("encoded %zu frames\n", framesEncoded);
+    }
+
+    for (;;) {
+        int32_t fetched = uspeak_get_audio_frames(sender, 1, packetTime, 60, packets, sizeof(packets), packetSizes, BATCH_PACKETS);
+        if (!Check(fetched, "uspeak_get_audio_frames")) {
+            return EXIT_FAILURE;
+        }
+        if (fetched == 0) {
+            break;
+        }
+        packetTime += 60u * (uint32_t)fetched;
+
+        int32_t ok = uspeak_decode_packets(receiver, packets, packetSizes, (size_t)fetched, decoded, samples, sizeof(samples) / sizeof(samples[0]));
+        if (!Check(ok, "uspeak_decode_packets")) {
+            return EXIT_FAILURE;
+        }
+
+        for (i = 0; i < fetched; i++) {
+            if (decoded[i].status != USPEAK_OK || decoded[i].playerId != 1) {
+                failedPackets++;
+            }
+            totalSamples += decoded[i].sampleCount;
+        }
+        totalPackets += (size_t)fetched;
+        batches++;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.structSize = sizeof(stats);
+    if (!Check(uspeak_get_stats(sender, &stats), "uspeak_get_stats")) {
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu packets in %d batches, %zu samples decoded, %zu failed\n", totalPackets, batches, totalSamples, failedPackets);
+    printf("sender: duration %u ms, position %u ms, queued %u frames, high water %u frames, dropped %llu, complexity %d\n",
+           stats.durationMs, stats.positionMs, stats.queuedFrames, stats.highWaterMarkFrames, (unsigned long long)stats.droppedFrames, stats.encoderComplexity);
+
+    uspeak_destroy(receiver);
+    uspeak_destroy(sender);
+
+    return (totalPackets > 0 && failedPackets == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,164 @@
+#include "mappedfile.h"
+
+#include <string>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+USpeakNative::Internal::MappedFile::MappedFile()
+    : m_data(nullptr)
+    , m_size(0)
+#ifdef _WIN32
+    , m_file(INVALID_HANDLE_VALUE)
+    , m_mapping(nullptr)
+#else
+    , m_fd(-1)
+#endif
+{
+}
+
+USpeakNative::Internal::MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool USpeakNative::Internal::MappedFile::open(std::string_view filename)
+{
+    close();
+
+    std::string path(filename);
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size)) {
+        close();
+        return false;
+    }
+    m_size = static_cast<std::size_t>(size.QuadPart);
+    if (m_size == 0) {
+        return true;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        close();
+        return false;
+    }
+
+    m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr) {
+        close();
+        return false;
+    }
+#else
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0) {
+        close();
+        return false;
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size == 0) {
+        return true;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED) {
+        close();
+        return false;
+    }
+    m_data = static_cast<const std::byte*>(data);
+#endif
+
+    return true;
+}
+
+void USpeakNative::Internal::MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_data != nullptr) {
+        munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+std::span<const std::byte> USpeakNative::Internal::MappedFile::data() const noexcept
+{
+    return std::span<const std::byte>(m_data, m_size);
+}
+
+void USpeakNative::Internal::MappedFile::adviseSequential() noexcept
+{
+#ifndef _WIN32
+    // Windows gets the same hint from FILE_FLAG_SEQUENTIAL_SCAN when the file is opened
+    if (m_data != nullptr) {
+        madvise(const_cast<std::byte*>(m_data), m_size, MADV_SEQUENTIAL);
+    }
+#endif
+}
+
+void USpeakNative::Internal::MappedFile::discard(std::size_t offset, std::size_t size) noexcept
+{
+    if (m_data == nullptr || offset >= m_size) {
+        return;
+    }
+    size = std::min(size, m_size - offset);
+
+    // Only whole pages can be dropped, shrink the range inwards to page boundaries
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    std::size_t pageSize = info.dwPageSize;
+#else
+    std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(m_data) + offset;
+    std::uintptr_t end = begin + size;
+    begin = (begin + pageSize - 1) / pageSize * pageSize;
+    end = end / pageSize * pageSize;
+    if (begin >= end) {
+        return;
+    }
+
+#ifdef _WIN32
+    // Unlocking pages that aren't locked removes them from the working set
+    VirtualUnlock(reinterpret_cast<void*>(begin), end - begin);
+#else
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+#endif
+}
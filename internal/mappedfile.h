@@ -0,0 +1,39 @@
+#ifndef USPEAK_MAPPEDFILE_H
+#define USPEAK_MAPPEDFILE_H
+
+#include <span>
+#include <cstdint>
+#include <string_view>
+
+namespace USpeakNative::Internal {
+
+// Read-only memory mapping of a whole file
+struct MappedFile {
+    MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    bool open(std::string_view filename);
+    void close();
+
+    std::span<const std::byte> data() const noexcept;
+
+    // Hints that the mapping will be read front to back, so the OS reads ahead
+    void adviseSequential() noexcept;
+    // Drops already consumed pages from the working set, they are faulted back in from the file if touched again
+    void discard(std::size_t offset, std::size_t size) noexcept;
+private:
+    const std::byte* m_data;
+    std::size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+}
+
+#endif // USPEAK_MAPPEDFILE_H
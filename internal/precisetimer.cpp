@@ -0,0 +1,63 @@
+#include "precisetimer.h"
+
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+USpeakNative::Internal::PreciseTimer::PreciseTimer()
+#ifdef _WIN32
+    : m_timer(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS))
+#endif
+{
+}
+
+USpeakNative::Internal::PreciseTimer::~PreciseTimer()
+{
+#ifdef _WIN32
+    if (m_timer != nullptr) {
+        CloseHandle(m_timer);
+    }
+#endif
+}
+
+void USpeakNative::Internal::PreciseTimer::sleepUntil(std::chrono::steady_clock::time_point deadline)
+{
+#ifdef _WIN32
+    auto remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining <= std::chrono::steady_clock::duration::zero()) {
+        return;
+    }
+
+    // High resolution waitable timers need Windows 10 1803, older systems fall back to the scheduler's default granularity
+    if (m_timer != nullptr) {
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -static_cast<LONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count() / 100);
+        if (SetWaitableTimer(m_timer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+            WaitForSingleObject(m_timer, INFINITE);
+            return;
+        }
+    }
+
+    std::this_thread::sleep_until(deadline);
+#else
+    // libstdc++ and libc++ both build steady_clock on CLOCK_MONOTONIC
+    auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(sinceEpoch / 1000000000);
+    ts.tv_nsec = static_cast<long>(sinceEpoch % 1000000000);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#endif
+}
@@ -0,0 +1,24 @@
+#ifndef USPEAK_PRECISETIMER_H
+#define USPEAK_PRECISETIMER_H
+
+#include <chrono>
+
+namespace USpeakNative::Internal {
+
+// Sleeps until an absolute steady_clock deadline with as little oversleep as the platform allows
+struct PreciseTimer {
+    PreciseTimer();
+    PreciseTimer(const PreciseTimer&) = delete;
+    PreciseTimer& operator=(const PreciseTimer&) = delete;
+    ~PreciseTimer();
+
+    void sleepUntil(std::chrono::steady_clock::time_point deadline);
+private:
+#ifdef _WIN32
+    void* m_timer;
+#endif
+};
+
+}
+
+#endif // USPEAK_PRECISETIMER_H
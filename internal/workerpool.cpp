@@ -0,0 +1,74 @@
+#include "workerpool.h"
+
+#include <algorithm>
+
+USpeakNative::Internal::WorkerPool::WorkerPool(std::size_t threads)
+    : m_mutex()
+    , m_wake()
+    , m_jobs()
+    , m_stop(false)
+    , m_threads()
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_threads.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        m_threads.emplace_back(&USpeakNative::Internal::WorkerPool::workerLoop, this);
+    }
+}
+
+USpeakNative::Internal::WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void USpeakNative::Internal::WorkerPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+std::size_t USpeakNative::Internal::WorkerPool::threadCount() const noexcept
+{
+    return m_threads.size();
+}
+
+USpeakNative::Internal::WorkerPool& USpeakNative::Internal::WorkerPool::Shared()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+void USpeakNative::Internal::WorkerPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> l(m_mutex);
+            m_wake.wait(l, [this] { return m_stop || !m_jobs.empty(); });
+
+            // Drain what was queued before shutting down so no job's promise is left unsatisfied
+            if (m_jobs.empty()) {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        job();
+    }
+}
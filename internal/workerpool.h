@@ -0,0 +1,40 @@
+#ifndef USPEAK_WORKERPOOL_H
+#define USPEAK_WORKERPOOL_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <functional>
+#include <condition_variable>
+
+namespace USpeakNative::Internal {
+
+// Fixed set of threads running submitted jobs in FIFO order, the shared pool is what background loads run on
+class WorkerPool
+{
+public:
+    // 0 threads means one per hardware thread
+    WorkerPool(std::size_t threads = 0);
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool();
+
+    void submit(std::function<void()> job);
+    std::size_t threadCount() const noexcept;
+
+    static WorkerPool& Shared();
+private:
+    void workerLoop();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_stop;
+    std::vector<std::thread> m_threads;
+};
+
+}
+
+#endif // USPEAK_WORKERPOOL_H
@@ -0,0 +1,278 @@
+#include "uspeaklite.h"
+#include "uspeakremux.h"
+#include "uspeaktrace.h"
+#include "uspeakoutputring.h"
+#include "uspeakpacket.h"
+#include "helpers.h"
+
+#include <map>
+#include <deque>
+#include <queue>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numbers>
+#include <algorithm>
+
+// Simulates a relay between one sender and one receiver on a virtual millisecond clock, so long sessions run faster than realtime.
+// The sender pushes a synthetic voice-like signal (or a file) every 20ms and sends a packet every packet interval,
+// the network applies loss, duplication, delay, jitter and reordering, and the receiver plays packets out of a fixed jitter buffer.
+
+struct LoopbackConfig {
+    double lossRate = 0.02;
+    double duplicateRate = 0.01;
+    double reorderRate = 0.02;
+    std::uint32_t delayMs = 40;
+    std::uint32_t jitterMs = 20;
+    std::uint32_t bufferMs = 80;
+    std::uint32_t packetIntervalMs = 60;
+    std::uint32_t seconds = 60;
+    std::uint32_t seed = 1;
+    std::string file;
+    std::string trace;
+};
+
+struct InFlightPacket {
+    std::uint32_t arrivalMs;
+    std::uint64_t sequence;
+    std::vector<std::byte> data;
+
+    bool operator>(const InFlightPacket& other) const {
+        return arrivalMs != other.arrivalMs ? arrivalMs > other.arrivalMs : sequence > other.sequence;
+    }
+};
+
+static bool ParseArgs(int argc, char** argv, LoopbackConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+
+        const char* value = argv[++i];
+        if (arg == "--loss") config.lossRate = std::atof(value);
+        else if (arg == "--dup") config.duplicateRate = std::atof(value);
+        else if (arg == "--reorder") config.reorderRate = std::atof(value);
+        else if (arg == "--delay") config.delayMs = static_cast<std::uint32_t>(std::atoi(value));
+        else if (arg == "--jitter") config.jitterMs = static_cast<std::uint32_t>(std::atoi(value));
+        else if (arg == "--buffer") config.bufferMs = static_cast<std::uint32_t>(std::atoi(value));
+        else if (arg == "--interval") config.packetIntervalMs = static_cast<std::uint32_t>(std::atoi(value));
+        else if (arg == "--seconds") config.seconds = static_cast<std::uint32_t>(std::atoi(value));
+        else if (arg == "--seed") config.seed = static_cast<std::uint32_t>(std::atoi(value));
+        else if (arg == "--file") config.file = value;
+        else if (arg == "--trace") config.trace = value;
+        else return false;
+    }
+
+    return config.packetIntervalMs >= 20 && config.packetIntervalMs % 20 == 0;
+}
+
+static std::uint32_t Percentile(std::vector<std::uint32_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+
+    std::size_t index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv) {
+    LoopbackConfig config;
+    if (!ParseArgs(argc, argv, config)) {
+        printf("Usage: USpeakLoopback.exe [--loss 0.02] [--dup 0.01] [--reorder 0.02] [--delay 40] [--jitter 20] [--buffer 80] [--interval 60] [--seconds 60] [--seed 1] [--file path] [--trace trace.json]\n");
+        return EXIT_FAILURE;
+    }
+
+    constexpr std::int32_t playerId = 1;
+    constexpr std::uint32_t frameMs = 20;
+    constexpr std::size_t frameSamples = 960;
+
+    if (!config.trace.empty()) {
+        USpeakNative::Trace::Enable(true);
+    }
+
+    USpeakNative::USpeakLite sender;
+    USpeakNative::USpeakLite receiver;
+
+    bool fromFile = !config.file.empty();
+    if (fromFile && !sender.streamFile(config.file)) {
+        printf("failed to load %s!\n", config.file.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<double> chance(0., 1.);
+    std::uniform_int_distribution<std::uint32_t> jitter(0, config.jitterMs);
+
+    // Capture time of every encoded frame that has not been sent yet
+    std::deque<std::uint32_t> frameCaptureMs;
+    std::map<std::uint32_t, std::uint32_t> packetCaptureMs;
+
+    std::priority_queue<InFlightPacket, std::vector<InFlightPacket>, std::greater<InFlightPacket>> network;
+    std::uint64_t sequence = 0;
+
+    std::map<std::uint32_t, std::vector<std::byte>> jitterBuffer;
+    bool playing = false;
+    std::uint32_t nextPlayoutPacketTime = 0;
+    std::uint32_t nextPlayoutMs = 0;
+
+    std::uint64_t packetsSent = 0;
+    std::uint64_t packetsLost = 0;
+    std::uint64_t packetsDuplicated = 0;
+    std::uint64_t packetsReordered = 0;
+    std::uint64_t packetsLate = 0;
+    std::uint64_t packetsDropped = 0;
+    std::uint64_t packetsPlayed = 0;
+    std::uint64_t packetsConcealed = 0;
+    std::uint32_t lastArrivedPacketTime = 0;
+    std::vector<std::uint32_t> latencies;
+    double decodeSeconds = 0.;
+
+    std::array<float, frameSamples> tone;
+    std::array<std::byte, USPEAK_BUFFERSIZE> packetBuffer;
+    USpeakNative::USpeakPacket decoded;
+
+    // Played out the way an audio device would pull it, 480 samples every 10ms
+    constexpr std::uint32_t deviceBlockMs = 10;
+    USpeakNative::USpeakOutputRing outputRing(48000);
+    std::array<float, 480> deviceBlock;
+    bool deviceStarted = false;
+
+    std::uint32_t endMs = config.seconds * 1000;
+    for (std::uint32_t nowMs = 0; nowMs <= endMs; nowMs++) {
+        // Sender: capture and encode one frame every 20ms, send a packet every interval
+        if (nowMs % frameMs == 0 && nowMs > 0) {
+            if (!fromFile) {
+                // Amplitude modulated harmonics, loosely shaped like voiced speech
+                for (std::size_t i = 0; i < frameSamples; i++) {
+                    double t = (static_cast<double>(nowMs - frameMs) + static_cast<double>(i) / 48.) / 1000.;
+                    double envelope = 0.5 + 0.5 * std::sin(2. * std::numbers::pi * 3. * t);
+                    tone[i] = static_cast<float>(0.2 * envelope * (std::sin(2. * std::numbers::pi * 180. * t) + 0.5 * std::sin(2. * std::numbers::pi * 360. * t)));
+                }
+                sender.pushSamples(tone, 48000, 1);
+            }
+            frameCaptureMs.push_back(nowMs - frameMs);
+        }
+
+        if (nowMs % config.packetIntervalMs == 0 && nowMs > 0) {
+            std::size_t size = sender.getAudioFrame(playerId, nowMs, packetBuffer);
+            if (size > USPEAK_HEADERSIZE) {
+                auto packet = std::span<const std::byte>(packetBuffer).first(size);
+
+                std::size_t offset = USPEAK_HEADERSIZE;
+                USpeakNative::USpeakFrameRef frame;
+                std::size_t nFrames = 0;
+                while (USpeakNative::NextFrame(packet, offset, frame)) nFrames++;
+
+                if (!frameCaptureMs.empty()) {
+                    packetCaptureMs[nowMs] = frameCaptureMs.front();
+                }
+                for (std::size_t i = 0; i < nFrames && !frameCaptureMs.empty(); i++) {
+                    frameCaptureMs.pop_front();
+                }
+
+                packetsSent++;
+
+                // Network: loss, duplication, delay with jitter, and occasional extra delay to force reordering
+                int copies = chance(rng) < config.duplicateRate ? 2 : 1;
+                if (copies == 2) packetsDuplicated++;
+                if (chance(rng) < config.lossRate) {
+                    packetsLost++;
+                    copies = 0;
+                }
+                for (int c = 0; c < copies; c++) {
+                    std::uint32_t delay = config.delayMs + jitter(rng);
+                    if (chance(rng) < config.reorderRate) {
+                        delay += config.packetIntervalMs;
+                    }
+                    network.push(InFlightPacket { nowMs + delay, sequence++, std::vector<std::byte>(packet.begin(), packet.end()) });
+                }
+            }
+        }
+
+        // Receiver: take arrivals into the jitter buffer
+        while (!network.empty() && network.top().arrivalMs <= nowMs) {
+            const InFlightPacket& arrived = network.top();
+            std::uint32_t packetTime = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(arrived.data.data(), 4);
+
+            if (packetTime < lastArrivedPacketTime) {
+                packetsReordered++;
+            }
+            lastArrivedPacketTime = std::max(lastArrivedPacketTime, packetTime);
+
+            if (!playing) {
+                playing = true;
+                nextPlayoutPacketTime = packetTime;
+                nextPlayoutMs = nowMs + config.bufferMs;
+            }
+
+            if (playing && packetTime < nextPlayoutPacketTime) {
+                packetsLate++;
+            } else if (!jitterBuffer.emplace(packetTime, arrived.data).second) {
+                packetsDropped++;
+            }
+
+            network.pop();
+        }
+
+        // Receiver: play out one packet slot per interval, concealing anything missing
+        if (playing && nowMs >= nextPlayoutMs) {
+            auto it = jitterBuffer.find(nextPlayoutPacketTime);
+            if (it != jitterBuffer.end()) {
+                auto decodeStart = std::chrono::steady_clock::now();
+                receiver.decodePacket(it->second, decoded);
+                outputRing.write(decoded.audioSamples);
+                deviceStarted = true;
+                decodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - decodeStart).count();
+
+                auto capture = packetCaptureMs.find(nextPlayoutPacketTime);
+                if (capture != packetCaptureMs.end()) {
+                    latencies.push_back(nowMs - capture->second);
+                }
+
+                packetsPlayed++;
+                jitterBuffer.erase(it);
+            } else {
+                packetsConcealed++;
+            }
+
+            packetCaptureMs.erase(packetCaptureMs.begin(), packetCaptureMs.upper_bound(nextPlayoutPacketTime));
+            jitterBuffer.erase(jitterBuffer.begin(), jitterBuffer.upper_bound(nextPlayoutPacketTime));
+
+            nextPlayoutPacketTime += config.packetIntervalMs;
+            nextPlayoutMs += config.packetIntervalMs;
+        }
+
+        if (deviceStarted && nowMs % deviceBlockMs == 0) {
+            outputRing.read(deviceBlock);
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::uint64_t slots = packetsPlayed + packetsConcealed;
+
+    printf("\nLoopback results (%us, loss %.3f, dup %.3f, reorder %.3f, delay %ums, jitter %ums, buffer %ums)\n",
+           config.seconds, config.lossRate, config.duplicateRate, config.reorderRate, config.delayMs, config.jitterMs, config.bufferMs);
+    printf("  packets sent:        %llu\n", (unsigned long long)packetsSent);
+    printf("  lost in network:     %llu\n", (unsigned long long)packetsLost);
+    printf("  duplicated:          %llu (%llu dropped at receiver)\n", (unsigned long long)packetsDuplicated, (unsigned long long)packetsDropped);
+    printf("  arrived reordered:   %llu\n", (unsigned long long)packetsReordered);
+    printf("  arrived too late:    %llu\n", (unsigned long long)packetsLate);
+    printf("  played / concealed:  %llu / %llu (concealment rate %.2f%%)\n",
+           (unsigned long long)packetsPlayed, (unsigned long long)packetsConcealed, slots == 0 ? 0. : 100. * (double)packetsConcealed / (double)slots);
+    printf("  glass-to-glass ms:   p50 %u, p90 %u, p99 %u, max %u\n",
+           Percentile(latencies, 0.5), Percentile(latencies, 0.9), Percentile(latencies, 0.99), latencies.empty() ? 0 : latencies.back());
+    printf("  device underruns:    %llu (%llu samples of silence)\n", (unsigned long long)outputRing.underruns(), (unsigned long long)outputRing.underrunSamples());
+    printf("  decode time:         %.3f ms total, %.1f us per packet\n", decodeSeconds * 1000., packetsPlayed == 0 ? 0. : decodeSeconds * 1e6 / (double)packetsPlayed);
+
+    if (!config.trace.empty()) {
+        USpeakNative::Trace::Enable(false);
+        if (USpeakNative::Trace::WriteChromeTrace(config.trace)) {
+            printf("  trace written to %s (%llu events dropped)\n", config.trace.c_str(), (unsigned long long)USpeakNative::Trace::DroppedEvents());
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
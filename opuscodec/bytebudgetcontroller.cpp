@@ -0,0 +1,100 @@
+#include "bytebudgetcontroller.h"
+
+#include <cmath>
+#include <algorithm>
+
+constexpr double BYTEBUDGET_TARGET = 0.75;         // Aim below the cap so VBR peaks still fit
+constexpr double BYTEBUDGET_CONSTRAIN_ABOVE = 0.7;  // Constrain VBR once frames get this close to the cap
+constexpr double BYTEBUDGET_RELEASE_BELOW = 0.55;   // and only go back to free VBR well below that, so the mode doesn't flap
+constexpr double BYTEBUDGET_AVERAGE_WEIGHT = 0.2;
+constexpr double BYTEBUDGET_MAX_STEP = 1.25;
+constexpr int BYTEBUDGET_MIN_BITRATE = 6000;
+constexpr int BYTEBUDGET_OPUS_MAX_BITRATE = 510000;
+
+USpeakNative::OpusCodec::ByteBudgetController::ByteBudgetController(std::size_t groupBytes, std::size_t framesPerGroup)
+    : m_frameLimit(groupBytes / std::max<std::size_t>(framesPerGroup, 1))
+    , m_frameDurationUs(0)
+    , m_bitrate(0)
+    , m_maxBitrate(0)
+    , m_constrainedVbr(true)
+    , m_changed(true)
+    , m_averageBytes(0.)
+{
+}
+
+std::size_t USpeakNative::OpusCodec::ByteBudgetController::frameLimit() const noexcept
+{
+    return m_frameLimit;
+}
+
+int USpeakNative::OpusCodec::ByteBudgetController::bitrate() const noexcept
+{
+    return m_bitrate;
+}
+
+bool USpeakNative::OpusCodec::ByteBudgetController::constrainedVbr() const noexcept
+{
+    return m_constrainedVbr;
+}
+
+double USpeakNative::OpusCodec::ByteBudgetController::averageFrameBytes() const noexcept
+{
+    return m_averageBytes;
+}
+
+bool USpeakNative::OpusCodec::ByteBudgetController::prepare(std::int64_t frameDurationUs) noexcept
+{
+    if (frameDurationUs <= 0) {
+        return false;
+    }
+
+    // The bitrate that exactly fills the target share of a frame's cap
+    if (frameDurationUs != m_frameDurationUs) {
+        m_frameDurationUs = frameDurationUs;
+
+        double targetBits = static_cast<double>(m_frameLimit) * BYTEBUDGET_TARGET * 8.;
+        m_maxBitrate = std::clamp(static_cast<int>(targetBits * 1000000. / static_cast<double>(frameDurationUs)), BYTEBUDGET_MIN_BITRATE, BYTEBUDGET_OPUS_MAX_BITRATE);
+        m_bitrate = m_maxBitrate;
+        m_changed = true;
+    }
+
+    bool changed = m_changed;
+    m_changed = false;
+    return changed;
+}
+
+void USpeakNative::OpusCodec::ByteBudgetController::frameEncoded(std::size_t bytes) noexcept
+{
+    if (m_frameDurationUs <= 0) {
+        return;
+    }
+
+    double frameBytes = static_cast<double>(bytes);
+    m_averageBytes = m_averageBytes == 0. ? frameBytes : m_averageBytes + (frameBytes - m_averageBytes) * BYTEBUDGET_AVERAGE_WEIGHT;
+
+    // Scale the bitrate by how far the recent frames are from the target, but never past the rate the budget allows.
+    // Use the larger of the average and the last frame so a single burst reacts immediately.
+    double targetBytes = static_cast<double>(m_frameLimit) * BYTEBUDGET_TARGET;
+    double observed = std::max(m_averageBytes, frameBytes);
+    double step = std::clamp(targetBytes / std::max(observed, 1.), 1. / BYTEBUDGET_MAX_STEP, BYTEBUDGET_MAX_STEP);
+
+    int bitrate = std::clamp(static_cast<int>(static_cast<double>(m_bitrate) * step), BYTEBUDGET_MIN_BITRATE, m_maxBitrate);
+    bool constrainedVbr = observed > static_cast<double>(m_frameLimit) * (m_constrainedVbr ? BYTEBUDGET_RELEASE_BELOW : BYTEBUDGET_CONSTRAIN_ABOVE);
+
+    // Ignore tiny changes, each one costs an encoder ctl
+    if (std::abs(bitrate - m_bitrate) * 50 > m_bitrate || constrainedVbr != m_constrainedVbr) {
+        m_bitrate = bitrate;
+        m_constrainedVbr = constrainedVbr;
+        m_changed = true;
+    }
+}
+
+void USpeakNative::OpusCodec::ByteBudgetController::reset() noexcept
+{
+    m_frameDurationUs = 0;
+    m_bitrate = 0;
+    m_maxBitrate = 0;
+    m_constrainedVbr = true;
+    m_changed = true;
+    m_averageBytes = 0.;
+}
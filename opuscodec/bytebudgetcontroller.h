@@ -0,0 +1,38 @@
+#ifndef USPEAK_BYTEBUDGETCONTROLLER_H
+#define USPEAK_BYTEBUDGETCONTROLLER_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace USpeakNative::OpusCodec {
+
+// Keeps every group of framesPerGroup consecutive frames inside groupBytes.
+// Each frame is hard capped at its share of the group, and the bitrate follows the measured frame sizes so the cap is rarely what limits a frame.
+class ByteBudgetController
+{
+public:
+    ByteBudgetController(std::size_t groupBytes, std::size_t framesPerGroup);
+
+    std::size_t frameLimit() const noexcept;
+    int bitrate() const noexcept;
+    bool constrainedVbr() const noexcept;
+    double averageFrameBytes() const noexcept;
+
+    // Returns true when the bitrate or VBR mode changed and has to be applied before encoding the next frame
+    bool prepare(std::int64_t frameDurationUs) noexcept;
+    void frameEncoded(std::size_t bytes) noexcept;
+    // Forgets the measured frame sizes, the next prepare() starts over at the full budget and asks for it to be applied
+    void reset() noexcept;
+private:
+    std::size_t m_frameLimit;
+    std::int64_t m_frameDurationUs;
+    int m_bitrate;
+    int m_maxBitrate;
+    bool m_constrainedVbr;
+    bool m_changed;
+    double m_averageBytes;
+};
+
+}
+
+#endif // USPEAK_BYTEBUDGETCONTROLLER_H
@@ -0,0 +1,119 @@
+#include "complexitycontroller.h"
+
+#include <thread>
+#include <algorithm>
+
+constexpr double COMPLEXITY_AVERAGE_WEIGHT = 0.1;
+constexpr double COMPLEXITY_RAISE_BELOW = 0.6;     // Fraction of the budget the average has to stay under before raising
+constexpr std::uint32_t COMPLEXITY_LOWER_AFTER = 3;  // Frames over budget, 60ms at 20ms frames
+constexpr std::uint32_t COMPLEXITY_RAISE_AFTER = 100; // Frames under budget, 2 seconds at 20ms frames
+constexpr std::uint32_t COMPLEXITY_COOLDOWN = 10;    // Frames to let the average settle after a change
+
+USpeakNative::OpusCodec::EncoderCpuBudget::EncoderCpuBudget(double targetLoad, unsigned int cores)
+    : m_targetLoad(std::clamp(targetLoad, 0.01, 1.))
+    , m_cores(cores != 0 ? cores : std::max(std::thread::hardware_concurrency(), 1u))
+    , m_encoders(0)
+{
+}
+
+void USpeakNative::OpusCodec::EncoderCpuBudget::addEncoder() noexcept
+{
+    m_encoders.fetch_add(1, std::memory_order::relaxed);
+}
+
+void USpeakNative::OpusCodec::EncoderCpuBudget::removeEncoder() noexcept
+{
+    m_encoders.fetch_sub(1, std::memory_order::relaxed);
+}
+
+std::size_t USpeakNative::OpusCodec::EncoderCpuBudget::encoders() const noexcept
+{
+    return m_encoders.load(std::memory_order::relaxed);
+}
+
+std::int64_t USpeakNative::OpusCodec::EncoderCpuBudget::frameBudgetUs(std::int64_t frameDurationUs) const noexcept
+{
+    std::size_t encoders = std::max<std::size_t>(m_encoders.load(std::memory_order::relaxed), 1);
+    return static_cast<std::int64_t>(static_cast<double>(frameDurationUs) * m_targetLoad * m_cores / static_cast<double>(encoders));
+}
+
+USpeakNative::OpusCodec::ComplexityController::ComplexityController(std::shared_ptr<EncoderCpuBudget> budget, int initialComplexity, int minComplexity, int maxComplexity)
+    : m_budget(std::move(budget))
+    , m_minComplexity(std::clamp(minComplexity, 0, 10))
+    , m_maxComplexity(std::clamp(maxComplexity, m_minComplexity, 10))
+    , m_complexity(std::clamp(initialComplexity, m_minComplexity, m_maxComplexity))
+    , m_initialComplexity(m_complexity)
+    , m_averageUs(0.)
+    , m_overBudget(0)
+    , m_underBudget(0)
+    , m_cooldown(0)
+{
+    if (m_budget != nullptr) {
+        m_budget->addEncoder();
+    }
+}
+
+USpeakNative::OpusCodec::ComplexityController::~ComplexityController()
+{
+    if (m_budget != nullptr) {
+        m_budget->removeEncoder();
+    }
+}
+
+int USpeakNative::OpusCodec::ComplexityController::complexity() const noexcept
+{
+    return m_complexity;
+}
+
+double USpeakNative::OpusCodec::ComplexityController::averageEncodeUs() const noexcept
+{
+    return m_averageUs;
+}
+
+bool USpeakNative::OpusCodec::ComplexityController::update(std::int64_t encodeUs, std::int64_t frameDurationUs) noexcept
+{
+    if (m_budget == nullptr) {
+        return false;
+    }
+
+    m_averageUs = m_averageUs == 0. ? static_cast<double>(encodeUs) : m_averageUs + (static_cast<double>(encodeUs) - m_averageUs) * COMPLEXITY_AVERAGE_WEIGHT;
+
+    if (m_cooldown > 0) {
+        m_cooldown--;
+        return false;
+    }
+
+    double budgetUs = static_cast<double>(m_budget->frameBudgetUs(frameDurationUs));
+
+    m_overBudget = m_averageUs > budgetUs ? m_overBudget + 1 : 0;
+    m_underBudget = m_averageUs < budgetUs * COMPLEXITY_RAISE_BELOW ? m_underBudget + 1 : 0;
+
+    int complexity = m_complexity;
+    if (m_overBudget >= COMPLEXITY_LOWER_AFTER) {
+        // Far over budget means the box is saturated, step down harder
+        complexity -= m_averageUs > budgetUs * 2. ? 2 : 1;
+    } else if (m_underBudget >= COMPLEXITY_RAISE_AFTER) {
+        complexity += 1;
+    }
+    complexity = std::clamp(complexity, m_minComplexity, m_maxComplexity);
+
+    if (complexity == m_complexity) {
+        return false;
+    }
+
+    m_complexity = complexity;
+    m_overBudget = 0;
+    m_underBudget = 0;
+    m_cooldown = COMPLEXITY_COOLDOWN;
+
+    return true;
+}
+
+void USpeakNative::OpusCodec::ComplexityController::reset() noexcept
+{
+    m_complexity = m_initialComplexity;
+    m_averageUs = 0.;
+    m_overBudget = 0;
+    m_underBudget = 0;
+    m_cooldown = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef USPEAK_COMPLEXITYCONTROLLER_H
+#define USPEAK_COMPLEXITYCONTROLLER_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace USpeakNative::OpusCodec {
+
+// Real-time CPU share available to every encoder on the host, the per-frame budget of one encoder shrinks as more encoders register
+class EncoderCpuBudget
+{
+public:
+    EncoderCpuBudget(double targetLoad = 0.5, unsigned int cores = 0);
+
+    void addEncoder() noexcept;
+    void removeEncoder() noexcept;
+    std::size_t encoders() const noexcept;
+
+    std::int64_t frameBudgetUs(std::int64_t frameDurationUs) const noexcept;
+private:
+    double m_targetLoad;
+    unsigned int m_cores;
+    std::atomic<std::size_t> m_encoders;
+};
+
+// Lowers the encoder complexity quickly when encodes overrun their budget and raises it slowly once there is headroom again
+class ComplexityController
+{
+public:
+    ComplexityController(std::shared_ptr<EncoderCpuBudget> budget, int initialComplexity = 10, int minComplexity = 0, int maxComplexity = 10);
+    ComplexityController(const ComplexityController&) = delete;
+    ComplexityController& operator=(const ComplexityController&) = delete;
+    ~ComplexityController();
+
+    int complexity() const noexcept;
+    double averageEncodeUs() const noexcept;
+
+    // Returns true when the complexity changed and has to be applied to the encoder
+    bool update(std::int64_t encodeUs, std::int64_t frameDurationUs) noexcept;
+    // Goes back to the initial complexity and forgets the measured encode times
+    void reset() noexcept;
+private:
+    std::shared_ptr<EncoderCpuBudget> m_budget;
+    int m_minComplexity;
+    int m_maxComplexity;
+    int m_complexity;
+    int m_initialComplexity;
+    double m_averageUs;
+    std::uint32_t m_overBudget;
+    std::uint32_t m_underBudget;
+    std::uint32_t m_cooldown;
+};
+
+}
+
+#endif // USPEAK_COMPLEXITYCONTROLLER_H
@@ -1,16 +1,15 @@
 #include "opuscodec.h"
 
 #include "opuserror.h"
+#include "opusstatepool.h"
 
 #define FMT_HEADER_ONLY
 #include <fmt/format.h>
-#include <opus.h>
 
 USpeakNative::OpusCodec::OpusCodec::OpusCodec(int sampleRate, int channels, USpeakNative::OpusCodec::OpusFrametime frametime)
-    : m_encoder(nullptr)
-    , m_decoder(nullptr)
-    , m_channels(channels)
+    : m_state(sampleRate, channels)
     , m_sampleRate(sampleRate)
+    , m_channels(channels)
     , m_frametime(frametime)
     , m_frameSize(channels * (int)frametime * (sampleRate / 1000))
     , m_encodeBuffer()
@@ -18,42 +17,24 @@ USpeakNative::OpusCodec::OpusCodec::OpusCodec(int sampleRate, int channels, USpe
 {
 }
 
+USpeakNative::OpusCodec::OpusCodec::OpusCodec(std::shared_ptr<USpeakNative::OpusCodec::OpusStatePool> statePool, USpeakNative::OpusCodec::OpusFrametime frametime)
+    : m_state(statePool->sampleRate(), statePool->channels(), statePool)
+    , m_sampleRate(statePool->sampleRate())
+    , m_channels(statePool->channels())
+    , m_frametime(frametime)
+    , m_frameSize(m_channels * (int)frametime * (m_sampleRate / 1000))
+    , m_encodeBuffer()
+    , m_decodeBuffer()
+{
+}
+
 USpeakNative::OpusCodec::OpusCodec::~OpusCodec()
 {
-    destroyCodecs();
 }
 
 bool USpeakNative::OpusCodec::OpusCodec::init()
 {
-    int err;
-    m_encoder = opus_encoder_create(m_sampleRate, m_channels, OPUS_APPLICATION_VOIP, &err);
-    if (err != OPUS_OK) {
-        destroyCodecs();
-        return false;
-    }
-    err = opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_sampleRate * sizeof(float) * 8));
-    if (err != OPUS_OK) {
-        destroyCodecs();
-        return false;
-    }
-    err = opus_encoder_ctl(m_encoder, OPUS_SET_INBAND_FEC(false));
-    if (err != OPUS_OK) {
-        destroyCodecs();
-        return false;
-    }
-    err = opus_encoder_ctl(m_encoder, OPUS_SET_PACKET_LOSS_PERC(0));
-    if (err != OPUS_OK) {
-        destroyCodecs();
-        return false;
-    }
-
-    m_decoder = opus_decoder_create(m_sampleRate, m_channels, &err);
-    if (err != OPUS_OK) {
-        destroyCodecs();
-        return false;
-    }
-
-    return true;
+    return m_state.init();
 }
 
 std::size_t USpeakNative::OpusCodec::OpusCodec::sampleSize() noexcept
@@ -77,7 +58,7 @@ std::span<const std::byte> USpeakNative::OpusCodec::OpusCodec::encodeFloat(std::
         return {};
     }
 
-    int num = opus_encode_float(m_encoder, samples.data(), (int)samples.size(), (std::uint8_t*)m_encodeBuffer.data(), (int)m_encodeBuffer.size());
+    int num = m_state.encode(samples, m_encodeBuffer);
     if (num < 0) {
         fmt::print("[USpeakNative] OpusCodec: Encode failed! Opus Error_{}\n", num);
         return {};
@@ -99,7 +80,7 @@ std::span<const float> USpeakNative::OpusCodec::OpusCodec::decodeFloat(std::span
         return {};
     }
 
-    int num = opus_decode_float(m_decoder, (const std::uint8_t*)data.data(), (int)data.size(), m_decodeBuffer.data(), (int)m_decodeBuffer.size(), 0);
+    int num = m_state.decode(data, m_decodeBuffer);
     if (num < 0) {
         fmt::print("[USpeakNative] OpusCodec: Decode failed! Opus Error_{}\n", num);
         return {};
@@ -111,15 +92,3 @@ std::span<const float> USpeakNative::OpusCodec::OpusCodec::decodeFloat(std::span
 
     return std::span<const float>(m_decodeBuffer.begin(), m_decodeBuffer.begin() + num);
 }
-
-void USpeakNative::OpusCodec::OpusCodec::destroyCodecs()
-{
-    if (m_encoder != nullptr) {
-        opus_encoder_destroy(m_encoder);
-        m_encoder = nullptr;
-    }
-    if (m_decoder != nullptr) {
-        opus_decoder_destroy(m_decoder);
-        m_decoder = nullptr;
-    }
-}
@@ -3,20 +3,20 @@
 
 #include "opusframetime.h"
 #include "bandmode.h"
+#include "opuscodecstate.h"
 
 #include <vector>
+#include <memory>
 #include <array>
 #include <span>
 
-class OpusEncoder;
-class OpusDecoder;
-
 namespace USpeakNative::OpusCodec {
 
 class OpusCodec
 {
 public:
     OpusCodec(int sampleRate, int channels, USpeakNative::OpusCodec::OpusFrametime frametime);
+    OpusCodec(std::shared_ptr<USpeakNative::OpusCodec::OpusStatePool> statePool, USpeakNative::OpusCodec::OpusFrametime frametime);
     ~OpusCodec();
 
     bool init();
@@ -25,10 +25,7 @@ public:
     std::span<const std::byte> encodeFloat(std::span<const float> samples, USpeakNative::OpusCodec::BandMode mode);
     std::span<const float> decodeFloat(std::span<const std::byte> data, USpeakNative::OpusCodec::BandMode mode);
 private:
-    void destroyCodecs();
-
-    OpusEncoder* m_encoder;
-    OpusDecoder* m_decoder;
+    USpeakNative::OpusCodec::OpusCodecState m_state;
     int m_sampleRate;
     int m_channels;
     USpeakNative::OpusCodec::OpusFrametime m_frametime;
@@ -0,0 +1,229 @@
+#include "opuscodecstate.h"
+
+#include "opusstatepool.h"
+#include "complexitycontroller.h"
+#include "bytebudgetcontroller.h"
+
+#include <opus.h>
+
+#include <chrono>
+#include <algorithm>
+
+// What opus_encoder_create starts with, pooled states only get OPUS_RESET_STATE which leaves the CTLs as the last owner set them
+constexpr int OPUSSTATE_DEFAULTCOMPLEXITY = 9;
+constexpr int OPUSSTATE_DEFAULTVBRCONSTRAINT = 1;
+
+USpeakNative::OpusCodec::OpusCodecState::OpusCodecState(int sampleRate, int channels, std::shared_ptr<USpeakNative::OpusCodec::OpusStatePool> statePool)
+    : m_encoder(nullptr)
+    , m_decoder(nullptr)
+    , m_statePool(std::move(statePool))
+    , m_complexityController()
+    , m_byteBudget()
+    , m_sampleRate(sampleRate)
+    , m_channels(channels)
+{
+}
+
+USpeakNative::OpusCodec::OpusCodecState::~OpusCodecState()
+{
+    destroy();
+}
+
+bool USpeakNative::OpusCodec::OpusCodecState::init()
+{
+    int err = OPUS_OK;
+    if (m_statePool != nullptr) {
+        if (m_statePool->sampleRate() != m_sampleRate || m_statePool->channels() != m_channels) {
+            return false;
+        }
+
+        m_encoder = m_statePool->acquireEncoder();
+        if (m_encoder == nullptr) {
+            return false;
+        }
+    } else {
+        m_encoder = opus_encoder_create(m_sampleRate, m_channels, OPUS_APPLICATION_VOIP, &err);
+        if (err != OPUS_OK) {
+            destroy();
+            return false;
+        }
+    }
+    if (!applyDefaults()) {
+        destroy();
+        return false;
+    }
+
+    if (m_statePool != nullptr) {
+        m_decoder = m_statePool->acquireDecoder();
+        if (m_decoder == nullptr) {
+            destroy();
+            return false;
+        }
+    } else {
+        m_decoder = opus_decoder_create(m_sampleRate, m_channels, &err);
+        if (err != OPUS_OK) {
+            destroy();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool USpeakNative::OpusCodec::OpusCodecState::reset()
+{
+    if (m_encoder == nullptr || m_decoder == nullptr) {
+        return false;
+    }
+
+    if (opus_encoder_ctl(m_encoder, OPUS_RESET_STATE) != OPUS_OK || opus_decoder_ctl(m_decoder, OPUS_RESET_STATE) != OPUS_OK) {
+        return false;
+    }
+
+    return applyDefaults();
+}
+
+void USpeakNative::OpusCodec::OpusCodecState::destroy()
+{
+    if (m_encoder != nullptr) {
+        if (m_statePool != nullptr) {
+            m_statePool->release(m_encoder);
+        } else {
+            opus_encoder_destroy(m_encoder);
+        }
+        m_encoder = nullptr;
+    }
+    if (m_decoder != nullptr) {
+        if (m_statePool != nullptr) {
+            m_statePool->release(m_decoder);
+        } else {
+            opus_decoder_destroy(m_decoder);
+        }
+        m_decoder = nullptr;
+    }
+}
+
+int USpeakNative::OpusCodec::OpusCodecState::encode(std::span<const float> samples, std::span<std::byte> packetOut) noexcept
+{
+    // libopus counts frame sizes per channel
+    int frameSize = (int)samples.size() / m_channels;
+    if (m_complexityController == nullptr && m_byteBudget == nullptr) {
+        return opus_encode_float(m_encoder, samples.data(), frameSize, (std::uint8_t*)packetOut.data(), (opus_int32)packetOut.size());
+    }
+
+    std::int64_t frameDurationUs = static_cast<std::int64_t>(frameSize) * 1000000 / m_sampleRate;
+
+    // libopus lowers the quality of a frame rather than exceed max_data_bytes, which makes the frame limit a hard guarantee
+    if (m_byteBudget != nullptr) {
+        if (m_byteBudget->prepare(frameDurationUs)) {
+            opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_byteBudget->bitrate()));
+            opus_encoder_ctl(m_encoder, OPUS_SET_VBR_CONSTRAINT(m_byteBudget->constrainedVbr() ? 1 : 0));
+        }
+        packetOut = packetOut.first(std::min(packetOut.size(), m_byteBudget->frameLimit()));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int num = opus_encode_float(m_encoder, samples.data(), frameSize, (std::uint8_t*)packetOut.data(), (opus_int32)packetOut.size());
+    std::int64_t encodeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    if (m_byteBudget != nullptr && num > 0) {
+        m_byteBudget->frameEncoded(static_cast<std::size_t>(num));
+    }
+    if (m_complexityController != nullptr && m_complexityController->update(encodeUs, frameDurationUs)) {
+        setComplexity(m_complexityController->complexity());
+    }
+
+    return num;
+}
+
+int USpeakNative::OpusCodec::OpusCodecState::decode(std::span<const std::byte> packet, std::span<float> samplesOut) noexcept
+{
+    int num = opus_decode_float(m_decoder, (const std::uint8_t*)packet.data(), (opus_int32)packet.size(), samplesOut.data(), (int)samplesOut.size() / m_channels, 0);
+    return num < 0 ? num : num * m_channels;
+}
+
+bool USpeakNative::OpusCodec::OpusCodecState::setCpuBudget(std::shared_ptr<USpeakNative::OpusCodec::EncoderCpuBudget> budget)
+{
+    if (budget == nullptr) {
+        m_complexityController.reset();
+        return true;
+    }
+
+    // Start at full complexity and let the controller work down from there
+    m_complexityController = std::make_unique<USpeakNative::OpusCodec::ComplexityController>(std::move(budget));
+    return setComplexity(m_complexityController->complexity());
+}
+
+bool USpeakNative::OpusCodec::OpusCodecState::setComplexity(int complexity) noexcept
+{
+    if (m_encoder == nullptr) {
+        return false;
+    }
+
+    return opus_encoder_ctl(m_encoder, OPUS_SET_COMPLEXITY(complexity)) == OPUS_OK;
+}
+
+int USpeakNative::OpusCodec::OpusCodecState::complexity() const noexcept
+{
+    opus_int32 complexity = -1;
+    if (m_encoder != nullptr) {
+        opus_encoder_ctl(m_encoder, OPUS_GET_COMPLEXITY(&complexity));
+    }
+    return complexity;
+}
+
+bool USpeakNative::OpusCodec::OpusCodecState::setByteBudget(std::size_t groupBytes, std::size_t framesPerGroup)
+{
+    if (groupBytes == 0 || framesPerGroup == 0) {
+        m_byteBudget.reset();
+        return m_encoder == nullptr || opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_sampleRate * sizeof(float) * 8)) == OPUS_OK;
+    }
+
+    m_byteBudget = std::make_unique<USpeakNative::OpusCodec::ByteBudgetController>(groupBytes, framesPerGroup);
+    return true;
+}
+
+int USpeakNative::OpusCodec::OpusCodecState::bitrate() const noexcept
+{
+    opus_int32 bitrate = -1;
+    if (m_encoder != nullptr) {
+        opus_encoder_ctl(m_encoder, OPUS_GET_BITRATE(&bitrate));
+    }
+    return bitrate;
+}
+
+bool USpeakNative::OpusCodec::OpusCodecState::applyDefaults() noexcept
+{
+    // The controllers start over too, otherwise the byte budget believes its bitrate is still applied
+    if (m_complexityController != nullptr) {
+        m_complexityController->reset();
+    }
+    if (m_byteBudget != nullptr) {
+        m_byteBudget->reset();
+    }
+
+    if (opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_sampleRate * sizeof(float) * 8)) != OPUS_OK) {
+        return false;
+    }
+    if (opus_encoder_ctl(m_encoder, OPUS_SET_INBAND_FEC(false)) != OPUS_OK) {
+        return false;
+    }
+    if (opus_encoder_ctl(m_encoder, OPUS_SET_PACKET_LOSS_PERC(0)) != OPUS_OK) {
+        return false;
+    }
+    if (opus_encoder_ctl(m_encoder, OPUS_SET_COMPLEXITY(m_complexityController != nullptr ? m_complexityController->complexity() : OPUSSTATE_DEFAULTCOMPLEXITY)) != OPUS_OK) {
+        return false;
+    }
+
+    return opus_encoder_ctl(m_encoder, OPUS_SET_VBR_CONSTRAINT(OPUSSTATE_DEFAULTVBRCONSTRAINT)) == OPUS_OK;
+}
+
+OpusEncoder* USpeakNative::OpusCodec::OpusCodecState::encoder() const noexcept
+{
+    return m_encoder;
+}
+
+OpusDecoder* USpeakNative::OpusCodec::OpusCodecState::decoder() const noexcept
+{
+    return m_decoder;
+}
@@ -0,0 +1,60 @@
+#ifndef USPEAK_OPUSCODECSTATE_H
+#define USPEAK_OPUSCODECSTATE_H
+
+#include <span>
+#include <memory>
+#include <cstddef>
+
+class OpusEncoder;
+class OpusDecoder;
+
+namespace USpeakNative::OpusCodec {
+
+class OpusStatePool;
+class EncoderCpuBudget;
+class ComplexityController;
+class ByteBudgetController;
+
+// Owns the libopus encoder/decoder pair, shared by the runtime and compile-time sized codecs
+class OpusCodecState
+{
+public:
+    OpusCodecState(int sampleRate, int channels, std::shared_ptr<USpeakNative::OpusCodec::OpusStatePool> statePool = nullptr);
+    OpusCodecState(const OpusCodecState&) = delete;
+    OpusCodecState& operator=(const OpusCodecState&) = delete;
+    ~OpusCodecState();
+
+    bool init();
+    // Clears the encoder/decoder history and settings, keeping the states and budgets, so the next stream starts like a fresh init()
+    bool reset();
+    void destroy();
+
+    int encode(std::span<const float> samples, std::span<std::byte> packetOut) noexcept;
+    int decode(std::span<const std::byte> packet, std::span<float> samplesOut) noexcept;
+
+    // Adapts the encoder complexity to the measured encode time, pass nullptr to stop adapting
+    bool setCpuBudget(std::shared_ptr<USpeakNative::OpusCodec::EncoderCpuBudget> budget);
+    bool setComplexity(int complexity) noexcept;
+    int complexity() const noexcept;
+
+    // Keeps any framesPerGroup consecutive encoded frames within groupBytes, pass 0 bytes to go back to the fixed bitrate
+    bool setByteBudget(std::size_t groupBytes, std::size_t framesPerGroup);
+    int bitrate() const noexcept;
+
+    OpusEncoder* encoder() const noexcept;
+    OpusDecoder* decoder() const noexcept;
+private:
+    bool applyDefaults() noexcept;
+
+    OpusEncoder* m_encoder;
+    OpusDecoder* m_decoder;
+    std::shared_ptr<USpeakNative::OpusCodec::OpusStatePool> m_statePool;
+    std::unique_ptr<USpeakNative::OpusCodec::ComplexityController> m_complexityController;
+    std::unique_ptr<USpeakNative::OpusCodec::ByteBudgetController> m_byteBudget;
+    int m_sampleRate;
+    int m_channels;
+};
+
+}
+
+#endif // USPEAK_OPUSCODECSTATE_H
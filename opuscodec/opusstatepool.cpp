@@ -0,0 +1,174 @@
+#include "opusstatepool.h"
+
+#include "../internal/scopedspinlock.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#include <opus.h>
+
+constexpr std::size_t AlignStateSize(int size) {
+    return size <= 0 ? 0 : ((static_cast<std::size_t>(size) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) * alignof(std::max_align_t);
+}
+
+// States are aligned to alignof(max_align_t), which can be smaller than sizeof(max_align_t), so round the slab up
+constexpr std::size_t SlabElements(std::size_t bytes) {
+    return (bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+}
+
+USpeakNative::OpusCodec::OpusStatePool::OpusStatePool(int sampleRate, int channels, std::size_t slabSize)
+    : m_lock(false)
+    , m_sampleRate(sampleRate)
+    , m_channels(channels)
+    , m_slabSize(slabSize == 0 ? 1 : slabSize)
+    , m_encoderSize(AlignStateSize(opus_encoder_get_size(channels)))
+    , m_decoderSize(AlignStateSize(opus_decoder_get_size(channels)))
+    , m_slabs()
+    , m_slabBytes(0)
+    , m_encoderCount(0)
+    , m_decoderCount(0)
+    , m_freeEncoders()
+    , m_freeDecoders()
+{
+}
+
+bool USpeakNative::OpusCodec::OpusStatePool::reserve(std::size_t encoders, std::size_t decoders)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    while (m_encoderCount < encoders) {
+        if (!addEncoderSlab()) return false;
+    }
+    while (m_decoderCount < decoders) {
+        if (!addDecoderSlab()) return false;
+    }
+
+    return true;
+}
+
+OpusEncoder* USpeakNative::OpusCodec::OpusStatePool::acquireEncoder()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    if (m_freeEncoders.empty() && !addEncoderSlab()) {
+        return nullptr;
+    }
+
+    OpusEncoder* encoder = m_freeEncoders.back();
+    m_freeEncoders.pop_back();
+
+    return encoder;
+}
+
+OpusDecoder* USpeakNative::OpusCodec::OpusStatePool::acquireDecoder()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    if (m_freeDecoders.empty() && !addDecoderSlab()) {
+        return nullptr;
+    }
+
+    OpusDecoder* decoder = m_freeDecoders.back();
+    m_freeDecoders.pop_back();
+
+    return decoder;
+}
+
+void USpeakNative::OpusCodec::OpusStatePool::release(OpusEncoder* encoder)
+{
+    if (encoder == nullptr) return;
+
+    opus_encoder_ctl(encoder, OPUS_RESET_STATE);
+
+    // The free list was sized for every state when its slab was added, so this never allocates
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    m_freeEncoders.push_back(encoder);
+}
+
+void USpeakNative::OpusCodec::OpusStatePool::release(OpusDecoder* decoder)
+{
+    if (decoder == nullptr) return;
+
+    opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    m_freeDecoders.push_back(decoder);
+}
+
+int USpeakNative::OpusCodec::OpusStatePool::sampleRate() const noexcept
+{
+    return m_sampleRate;
+}
+
+int USpeakNative::OpusCodec::OpusStatePool::channels() const noexcept
+{
+    return m_channels;
+}
+
+std::size_t USpeakNative::OpusCodec::OpusStatePool::memoryUsage() const noexcept
+{
+    return m_slabBytes;
+}
+
+bool USpeakNative::OpusCodec::OpusStatePool::addEncoderSlab()
+{
+    if (m_encoderSize == 0) {
+        fmt::print("[USpeakNative] OpusStatePool: Invalid channel count {}!\n", m_channels);
+        return false;
+    }
+
+    std::size_t bytes = m_encoderSize * m_slabSize;
+    auto slab = std::make_unique<std::max_align_t[]>(SlabElements(bytes));
+    std::byte* base = reinterpret_cast<std::byte*>(slab.get());
+
+    m_freeEncoders.reserve(m_encoderCount + m_slabSize);
+    for (std::size_t i = 0; i < m_slabSize; i++) {
+        OpusEncoder* encoder = reinterpret_cast<OpusEncoder*>(base + i * m_encoderSize);
+
+        int err = opus_encoder_init(encoder, m_sampleRate, m_channels, OPUS_APPLICATION_VOIP);
+        if (err != OPUS_OK) {
+            fmt::print("[USpeakNative] OpusStatePool: Encoder init failed! Opus Error_{}\n", err);
+            m_freeEncoders.resize(m_freeEncoders.size() - i);
+            return false;
+        }
+
+        m_freeEncoders.push_back(encoder);
+    }
+
+    m_slabs.push_back(std::move(slab));
+    m_slabBytes += bytes;
+    m_encoderCount += m_slabSize;
+
+    return true;
+}
+
+bool USpeakNative::OpusCodec::OpusStatePool::addDecoderSlab()
+{
+    if (m_decoderSize == 0) {
+        fmt::print("[USpeakNative] OpusStatePool: Invalid channel count {}!\n", m_channels);
+        return false;
+    }
+
+    std::size_t bytes = m_decoderSize * m_slabSize;
+    auto slab = std::make_unique<std::max_align_t[]>(SlabElements(bytes));
+    std::byte* base = reinterpret_cast<std::byte*>(slab.get());
+
+    m_freeDecoders.reserve(m_decoderCount + m_slabSize);
+    for (std::size_t i = 0; i < m_slabSize; i++) {
+        OpusDecoder* decoder = reinterpret_cast<OpusDecoder*>(base + i * m_decoderSize);
+
+        int err = opus_decoder_init(decoder, m_sampleRate, m_channels);
+        if (err != OPUS_OK) {
+            fmt::print("[USpeakNative] OpusStatePool: Decoder init failed! Opus Error_{}\n", err);
+            m_freeDecoders.resize(m_freeDecoders.size() - i);
+            return false;
+        }
+
+        m_freeDecoders.push_back(decoder);
+    }
+
+    m_slabs.push_back(std::move(slab));
+    m_slabBytes += bytes;
+    m_decoderCount += m_slabSize;
+
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef USPEAK_OPUSSTATEPOOL_H
+#define USPEAK_OPUSSTATEPOOL_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+class OpusEncoder;
+class OpusDecoder;
+
+namespace USpeakNative::OpusCodec {
+
+// Slab allocated Opus encoder/decoder states, initialized once and reset with OPUS_RESET_STATE when released
+class OpusStatePool
+{
+public:
+    OpusStatePool(int sampleRate, int channels, std::size_t slabSize = 16);
+    OpusStatePool(const OpusStatePool&) = delete;
+    OpusStatePool& operator=(const OpusStatePool&) = delete;
+
+    bool reserve(std::size_t encoders, std::size_t decoders);
+
+    OpusEncoder* acquireEncoder();
+    OpusDecoder* acquireDecoder();
+    void release(OpusEncoder* encoder);
+    void release(OpusDecoder* decoder);
+
+    int sampleRate() const noexcept;
+    int channels() const noexcept;
+    std::size_t memoryUsage() const noexcept;
+private:
+    bool addEncoderSlab();
+    bool addDecoderSlab();
+
+    std::atomic_bool m_lock;
+    int m_sampleRate;
+    int m_channels;
+    std::size_t m_slabSize;
+    std::size_t m_encoderSize;
+    std::size_t m_decoderSize;
+    std::vector<std::unique_ptr<std::max_align_t[]>> m_slabs;
+    std::size_t m_slabBytes;
+    std::size_t m_encoderCount;
+    std::size_t m_decoderCount;
+    std::vector<OpusEncoder*> m_freeEncoders;
+    std::vector<OpusDecoder*> m_freeDecoders;
+};
+
+}
+
+#endif // USPEAK_OPUSSTATEPOOL_H
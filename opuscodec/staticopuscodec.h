@@ -0,0 +1,78 @@
+#ifndef USPEAK_STATICOPUSCODEC_H
+#define USPEAK_STATICOPUSCODEC_H
+
+#include "opusframetime.h"
+#include "opuscodecstate.h"
+
+#include <span>
+#include <array>
+#include <memory>
+#include <cstddef>
+
+namespace USpeakNative::OpusCodec {
+
+// OpusCodec with its configuration fixed at compile time, buffers are sized up front and calls skip all runtime checks
+template <int SampleRate, int Channels, USpeakNative::OpusCodec::OpusFrametime Frametime>
+class StaticOpusCodec
+{
+    static_assert(SampleRate == 8000 || SampleRate == 12000 || SampleRate == 16000 || SampleRate == 24000 || SampleRate == 48000, "Opus only supports 8, 12, 16, 24 and 48 kHz");
+    static_assert(Channels == 1 || Channels == 2, "Opus only supports mono and stereo");
+public:
+    static constexpr std::size_t FrameSize = static_cast<std::size_t>(Channels * static_cast<int>(Frametime) * (SampleRate / 1000));
+
+    // A single Opus frame is at most 1275 bytes, longer frametimes are packed as multiple 20ms frames (RFC 6716 section 3.2.5)
+    static constexpr std::size_t MaxPacketSize = static_cast<int>(Frametime) <= 20 ? 1275 : 1275 * (static_cast<int>(Frametime) / 20) + 7;
+
+    // Decoding takes whatever the sender encoded, and an Opus packet can carry up to 120ms regardless of our own frametime
+    static constexpr std::size_t MaxDecodeSize = static_cast<std::size_t>(Channels * 120 * (SampleRate / 1000));
+
+    StaticOpusCodec()
+        : m_state(SampleRate, Channels)
+        , m_encodeBuffer()
+        , m_decodeBuffer()
+    {
+    }
+    StaticOpusCodec(std::shared_ptr<USpeakNative::OpusCodec::OpusStatePool> statePool)
+        : m_state(SampleRate, Channels, std::move(statePool))
+        , m_encodeBuffer()
+        , m_decodeBuffer()
+    {
+    }
+
+    bool init() {
+        return m_state.init();
+    }
+
+    static constexpr std::size_t sampleSize() noexcept {
+        return FrameSize;
+    }
+
+    // Returns an empty span on failure
+    std::span<const std::byte> encodeFloat(std::span<const float, FrameSize> samples) noexcept {
+        int num = m_state.encode(samples, m_encodeBuffer);
+        if (num <= 0) return {};
+
+        return std::span<const std::byte>(m_encodeBuffer.data(), static_cast<std::size_t>(num));
+    }
+    std::span<const float> decodeFloat(std::span<const std::byte> data) noexcept {
+        int num = m_state.decode(data, m_decodeBuffer);
+        if (num <= 0) return {};
+
+        // The state already counts the samples of all channels
+        return std::span<const float>(m_decodeBuffer.data(), static_cast<std::size_t>(num));
+    }
+
+    USpeakNative::OpusCodec::OpusCodecState& state() noexcept {
+        return m_state;
+    }
+private:
+    USpeakNative::OpusCodec::OpusCodecState m_state;
+    std::array<std::byte, MaxPacketSize> m_encodeBuffer;
+    std::array<float, MaxDecodeSize> m_decodeBuffer;
+};
+
+using USpeakOpusCodec = StaticOpusCodec<48000, 1, USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms>;
+
+}
+
+#endif // USPEAK_STATICOPUSCODEC_H
@@ -2,23 +2,15 @@
 #include "libnyquist/Decoders.h"
 #include "libnyquist/Encoders.h"
 #include "uspeaklite.h"
+#include "uspeakoggrecorder.h"
+#include "uspeakcapture.h"
+#include "uspeakanalytics.h"
+#include "uspeakmemory.h"
 #include "base64.h"
 
 #include <iostream>
 #include <fstream>
-
-void InsertAudio(std::vector<float>& target, std::uint32_t posMs, std::span<const float> src) {
-    std::uint32_t targetIndex = posMs * 48;
-
-    std::size_t requiredSpace = targetIndex + src.size();
-    if (target.size() < requiredSpace) {
-        target.resize(requiredSpace);
-    }
-
-    for (std::uint32_t i = 0; i < src.size(); i++) {
-        target[targetIndex + i] = (target[targetIndex + i] + src[i]) / 2.f;
-    }
-}
+#include <memory_resource>
 
 bool writeDiff(const std::string& name, const std::vector<std::byte>& data) {
     std::fstream diff_fs("uspeak_diff_" + name + ".bin", std::ios::out | std::ios::binary);
@@ -152,73 +144,104 @@ private:
     std::array<T, StatSize> m_samplesAccum;
 };
 
+// Decodes and re-encodes one packet over and over on an arena, once warmed up neither the arena's upstream nor the default resource may see an allocation
+bool CheckSteadyStateAllocations(std::span<const std::byte> rawData) {
+    constexpr int WarmupRounds = 8;
+    constexpr int CheckedRounds = 256;
+
+    // An instance of its own, so the check doesn't touch the main run's player state or capture
+    USpeakNative::USpeakLite uSpeak;
+
+    USpeakNative::CountingMemoryResource upstream(std::pmr::new_delete_resource());
+    std::array<std::byte, 65536> arenaBuffer;
+    std::pmr::monotonic_buffer_resource arena(arenaBuffer.data(), arenaBuffer.size(), &upstream);
+
+    USpeakNative::CountingMemoryResource defaultResource(std::pmr::get_default_resource());
+    std::pmr::memory_resource* previousDefault = std::pmr::set_default_resource(&defaultResource);
+
+    bool ok = true;
+    for (int i = 0; i < WarmupRounds + CheckedRounds && ok; i++) {
+        if (i == WarmupRounds) {
+            upstream.resetCounters();
+            defaultResource.resetCounters();
+        }
+
+        arena.release();
+        USpeakNative::USpeakPacket packet(&arena);
+        std::pmr::vector<std::byte> encoded(&arena);
+        ok = uSpeak.decodePacket(rawData, packet) && uSpeak.encodePacket(packet, encoded);
+    }
+
+    std::pmr::set_default_resource(previousDefault);
+
+    if (!ok) {
+        printf("Allocation check: packet did not round trip, skipped\n");
+        return true;
+    }
+
+    printf("Allocation check: %llu arena upstream allocations, %llu default resource allocations over %i decode/encode rounds\n",
+           (unsigned long long)upstream.allocations(), (unsigned long long)defaultResource.allocations(), CheckedRounds);
+
+    return upstream.allocations() == 0 && defaultResource.allocations() == 0;
+}
+
 int main(int argc, char**argv) {
     if (argc != 2) {
-        printf("Usage: USpeakTest.exe [path_to_photon_log]");
+        printf("Usage: USpeakTest.exe [path_to_photon_log|path_to_capture.uspcap]");
         return EXIT_FAILURE;
     }
 
     AudioMeaner<float, 200> meaner;
 
-    std::fstream ifs(argv[1], std::ios::in);
-    if (!ifs.is_open()) {
-        printf("failed to open logfile!");
-        return EXIT_FAILURE;
-    }
-
     USpeakNative::USpeakLite uSpeak;
+    USpeakNative::USpeakOggRecorder recorder("test_");
+    USpeakNative::USpeakAnalytics analytics;
 
     std::uint32_t startMs = UINT32_MAX;
     std::uint32_t endMs = 0;
-    std::vector<std::byte> rawData;
-    std::vector<USpeakNative::USpeakPacket> packets;
 
     // std::int32_t firstId = 0;
 
-    auto json = nlohmann::json::parse(ifs);
-    for (const auto& entry : json) {
-        if (entry["patch_name"] != "OnEventPatch") continue;
+    std::vector<std::byte> firstPacket;
 
-        auto& eventData = entry["patch_args"]["eventData"];
-        if (eventData["Code"] != 1.f) continue;
-
-        auto& customData = eventData["CustomData"];
-        if (customData["type"] != "System.Byte[]") continue;
+    auto handlePacket = [&](std::span<const std::byte> rawData) -> bool {
+        if (firstPacket.empty()) {
+            firstPacket.assign(rawData.begin(), rawData.end());
+        }
 
-        auto err = macaron::Base64::Decode(customData["data"], rawData);
-        if (err != "") {
-            printf("Error: %s\n", err.c_str());
-            continue;
+        if (!recorder.addPacket(rawData)) {
+            printf("Recording error!\n");
         }
 
         USpeakNative::USpeakPacket packet;
         if (!uSpeak.decodePacket(rawData, packet)) {
             printf("Decoding error!\n");
-            return EXIT_FAILURE;
+            return false;
         }
 
         PrintGraph<float, 200, 80>(packet.audioSamples);
         meaner.Add(packet.audioSamples);
+        analytics.analyze(packet);
 /*
         std::vector<std::byte> reEncoded;
         if (!uSpeak.encodePacket(packet, reEncoded)) {
             printf("Encoding error!\n");
-            return EXIT_FAILURE;
+            return false;
         }
-        if (rawData != reEncoded) {
+        if (!std::ranges::equal(rawData, reEncoded)) {
             printf("DIFFERENT, saving diff...\n");
 
             std::fstream diff_fs("uspeak_diff.bin", std::ios::out | std::ios::binary);
-            if (!writeDiff("a", rawData) || !writeDiff("b", reEncoded)) {
+            if (!writeDiff("a", std::vector<std::byte>(rawData.begin(), rawData.end())) || !writeDiff("b", reEncoded)) {
                 printf("failed to create diff file!");
             }
-            return EXIT_FAILURE;
+            return false;
         }*/
 /*
         if (firstId == 0) {
             firstId = packet.playerId;
             printf("PlayerID: %i\n", firstId);
-        } else if (packet.playerId != firstId) continue;
+        } else if (packet.playerId != firstId) return true;
 */
         if (packet.packetTime < startMs) {
             startMs = packet.packetTime;
@@ -226,31 +249,81 @@ int main(int argc, char**argv) {
             endMs = packet.packetTime;
         }
 
-        packets.push_back(std::move(packet));
+        return true;
+    };
+
+    std::string_view path = argv[1];
+    if (path.ends_with(".uspcap")) {
+        USpeakNative::USpeakCaptureReader capture;
+        if (!capture.open(path)) {
+            printf("failed to open capture!");
+            return EXIT_FAILURE;
+        }
+
+        for (const auto& entry : capture.entries()) {
+            if (!handlePacket(capture.record(entry).packet)) {
+                return EXIT_FAILURE;
+            }
+        }
+    } else {
+        std::fstream ifs(argv[1], std::ios::in);
+        if (!ifs.is_open()) {
+            printf("failed to open logfile!");
+            return EXIT_FAILURE;
+        }
+
+        // Save a capture of the log, so the next run can skip parsing it
+        auto captureWriter = std::make_shared<USpeakNative::USpeakCaptureWriter>();
+        if (captureWriter->open("test.uspcap")) {
+            uSpeak.setCaptureWriter(captureWriter);
+        }
+
+        std::vector<std::byte> rawData;
+
+        auto json = nlohmann::json::parse(ifs);
+        for (const auto& entry : json) {
+            if (entry["patch_name"] != "OnEventPatch") continue;
+
+            auto& eventData = entry["patch_args"]["eventData"];
+            if (eventData["Code"] != 1.f) continue;
+
+            auto& customData = eventData["CustomData"];
+            if (customData["type"] != "System.Byte[]") continue;
+
+            auto err = macaron::Base64::Decode(customData["data"], rawData);
+            if (err != "") {
+                printf("Error: %s\n", err.c_str());
+                continue;
+            }
+
+            if (!handlePacket(rawData)) {
+                return EXIT_FAILURE;
+            }
+        }
+
+        uSpeak.setCaptureWriter(nullptr);
+        captureWriter->close();
     }
 
     auto mean = meaner.GetMean();
     PrintGraph<float, 200, 80>(mean);
 
-    nqr::AudioData data;
-    data.samples.reserve(5000000);
-
-    for (const auto& packet : packets) {
-        InsertAudio(data.samples, packet.packetTime - startMs, packet.audioSamples);
+    std::vector<USpeakNative::AudioWindowMetrics> windows;
+    analytics.flush();
+    analytics.collect(windows);
+    for (const auto& window : windows) {
+        printf("Player %i @ %u: peak %.1f dB, rms %.1f dB, %u clipped, %.0f%% speech%s\n",
+               window.playerId, window.windowStart, window.peakDb, window.rmsDb, window.clippedSamples, window.speechRatio * 100.f,
+               window.clippedSamples > 0 ? " [CLIPPING]" : "");
     }
 
-    nqr::EncoderParams params;
-    params.channelCount = 1;
-    params.dither = nqr::DitherType::DITHER_NONE;
-    params.targetFormat = nqr::PCMFormat::PCM_FLT;
+    recorder.finish();
 
-    data.channelCount = 1;
-    data.lengthSeconds = (float)(endMs - startMs) / 1000.f;
-    data.sampleRate = 48000;
-    data.sourceFormat = nqr::PCMFormat::PCM_FLT;
+    if (!firstPacket.empty() && !CheckSteadyStateAllocations(firstPacket)) {
+        printf("Steady state decode/encode allocated!\n");
+        return EXIT_FAILURE;
+    }
 
-    printf("Length is %f seconds!\n", data.lengthSeconds);
+    printf("Length is %f seconds!\n", (float)(endMs - startMs) / 1000.f);
     fflush(stdout);
-
-    nqr::encode_opus_to_disk(params, &data, "test.ogg");
 }
@@ -0,0 +1,205 @@
+#include "uspeakingest.h"
+#include "uspeakpacket.h"
+#include "uspeakframecontainer.h"
+#include "uspeakframefile.h"
+#include "uspeakframestore.h"
+#include "opuscodec/staticopuscodec.h"
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <fstream>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+struct TranscodeJob {
+    fs::path input;
+    fs::path output;
+    bool ok;
+    std::size_t frames;
+    double seconds;
+};
+
+static bool CollectInputs(const fs::path& input, std::vector<fs::path>& files) {
+    std::error_code ec;
+
+    if (fs::is_directory(input, ec)) {
+        for (const auto& entry : fs::recursive_directory_iterator(input, ec)) {
+            if (!entry.is_regular_file()) continue;
+
+            auto ext = entry.path().extension().string();
+            if (ext == ".wav" || ext == ".ogg" || ext == ".opus" || ext == ".flac" || ext == ".mp3" || ext == ".wv" || ext == ".mpc") {
+                files.push_back(entry.path());
+            }
+        }
+        return !ec;
+    }
+
+    // Anything else is a manifest with one path per line, relative paths are relative to the manifest
+    std::fstream manifest(input, std::ios::in);
+    if (!manifest.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        fs::path path(line);
+        files.push_back(path.is_absolute() ? path : input.parent_path() / path);
+    }
+
+    return true;
+}
+
+// Mirrors the input's path below the input root, so files with the same name in different folders stay apart
+static fs::path OutputPath(const fs::path& outputDir, const fs::path& inputRoot, const fs::path& input) {
+    std::error_code ec;
+    fs::path relative = fs::absolute(input, ec).lexically_normal().lexically_relative(fs::absolute(inputRoot, ec).lexically_normal());
+
+    // Manifest entries outside the manifest's folder only keep their name
+    if (ec || relative.empty() || *relative.begin() == "..") {
+        relative = input.filename();
+    }
+
+    return (outputDir / relative).replace_extension(".uspkf");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        printf("Usage: USpeakTranscoder.exe [input_directory|manifest] [output_directory] (threads)\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<fs::path> inputs;
+    if (!CollectInputs(argv[1], inputs)) {
+        printf("failed to read input list!\n");
+        return EXIT_FAILURE;
+    }
+
+    fs::path outputDir(argv[2]);
+    std::error_code ec;
+    fs::create_directories(outputDir, ec);
+    if (ec) {
+        printf("failed to create output directory!\n");
+        return EXIT_FAILURE;
+    }
+
+    unsigned nThreads = argc == 4 ? static_cast<unsigned>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+    if (nThreads == 0) nThreads = 1;
+
+    fs::path inputRoot = fs::is_directory(argv[1], ec) ? fs::path(argv[1]) : fs::path(argv[1]).parent_path();
+
+    std::vector<TranscodeJob> jobs(inputs.size());
+    std::map<fs::path, std::size_t> outputs;
+    for (std::size_t i = 0; i < inputs.size(); i++) {
+        jobs[i].input = inputs[i];
+        jobs[i].output = OutputPath(outputDir, inputRoot, inputs[i]);
+        jobs[i].ok = false;
+        jobs[i].frames = 0;
+        jobs[i].seconds = 0.;
+
+        // Only the extension differs (song.wav and song.mp3), or the manifest lists a file twice
+        auto [it, inserted] = outputs.emplace(jobs[i].output.lexically_normal(), i);
+        if (!inserted) {
+            printf("%s and %s would both be written to %s!\n", jobs[it->second].input.string().c_str(), inputs[i].string().c_str(), jobs[i].output.string().c_str());
+            return EXIT_FAILURE;
+        }
+
+        fs::create_directories(jobs[i].output.parent_path(), ec);
+        if (ec) {
+            printf("failed to create %s!\n", jobs[i].output.parent_path().string().c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Transcoding %zu files on %u threads...\n", jobs.size(), nThreads);
+
+    std::mutex printMutex;
+    std::atomic_size_t nextJob = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        // Every worker owns its encoder, so workers never contend on codec state
+        USpeakNative::OpusCodec::USpeakOpusCodec codec;
+        if (!codec.init()) {
+            std::lock_guard l(printMutex);
+            printf("failed to initialize codec!\n");
+            return;
+        }
+
+        // Same frame size limit as live encoding, so pre-encoded frames always pack into full packets
+        codec.state().setByteBudget(USPEAK_PACKETFRAMEBYTES, USPEAK_FRAMESPERPACKET);
+
+        for (std::size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+            TranscodeJob& job = jobs[i];
+            auto jobStart = std::chrono::steady_clock::now();
+
+            USpeakNative::USpeakFrameStore frames((std::uint32_t)USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms);
+            float loudness = std::numeric_limits<float>::quiet_NaN();
+
+            job.ok = USpeakNative::EncodeFile(job.input.string(), codec, frames, loudness);
+            if (job.ok) {
+                USpeakNative::USpeakFrameFileInfo info;
+                info.sampleRate = 48000;
+                info.channels = 1;
+                info.frameDurationMs = (std::uint32_t)USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms;
+                info.frameCount = static_cast<std::uint32_t>(frames.size());
+                info.loudness = loudness;
+
+                job.ok = USpeakNative::WriteFrameFile(job.output.string(), frames, info);
+                job.frames = frames.size();
+            }
+
+            // Reset the encoder so the next file does not start with this file's state, the byte budget stays in place
+            bool reset = codec.state().reset();
+
+            job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - jobStart).count();
+
+            std::lock_guard l(printMutex);
+            printf("[%s] %s -> %s (%zu frames, %.3fs, %.1fx realtime)\n",
+                   job.ok ? " OK " : "FAIL",
+                   job.input.string().c_str(),
+                   job.output.string().c_str(),
+                   job.frames,
+                   job.seconds,
+                   job.seconds > 0. ? (job.frames * 0.02) / job.seconds : 0.);
+
+            // Leave the remaining jobs to the other workers, jobs nobody picks up are counted as failed
+            if (!reset) {
+                printf("failed to reset codec!\n");
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t failed = 0;
+    std::size_t totalFrames = 0;
+    for (const auto& job : jobs) {
+        if (!job.ok) failed++;
+        totalFrames += job.frames;
+    }
+
+    printf("Done: %zu files, %zu failed, %.1f seconds of audio in %.3fs\n", jobs.size(), failed, totalFrames * 0.02, totalSeconds);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
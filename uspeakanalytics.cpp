@@ -0,0 +1,220 @@
+#include "uspeakanalytics.h"
+
+#include <cmath>
+#include <limits>
+#include <complex>
+#include <numbers>
+#include <algorithm>
+
+constexpr std::size_t ANALYTICS_FRAMESIZE = 960;
+constexpr std::size_t ANALYTICS_FFTSIZE = 512;
+constexpr std::size_t ANALYTICS_FFTBITS = 9;
+constexpr std::size_t ANALYTICS_LANES = 8;
+constexpr float ANALYTICS_SILENCE_DB = -100.f;
+constexpr float ANALYTICS_SPEECH_MIN_DB = -55.f;
+constexpr float ANALYTICS_SPEECH_ABOVE_FLOOR_DB = 9.f;
+constexpr float ANALYTICS_FLOOR_RISE_DB = 0.05f;
+
+// Upper edge of every band as an FFT bin, 93.75 Hz per bin
+constexpr std::array<std::size_t, USpeakNative::ANALYTICS_BANDCOUNT> ANALYTICS_BANDEDGES = { 2, 3, 6, 11, 22, 43, 86, 257 };
+
+namespace {
+
+struct FftTables {
+    std::array<float, ANALYTICS_FFTSIZE> window;
+    std::array<std::complex<float>, ANALYTICS_FFTSIZE / 2> twiddles;
+    std::array<std::uint16_t, ANALYTICS_FFTSIZE> bitReverse;
+
+    FftTables() {
+        for (std::size_t i = 0; i < ANALYTICS_FFTSIZE; i++) {
+            window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2. * std::numbers::pi * static_cast<double>(i) / ANALYTICS_FFTSIZE));
+
+            std::size_t reversed = 0;
+            for (std::size_t b = 0; b < ANALYTICS_FFTBITS; b++) {
+                reversed |= ((i >> b) & 1) << (ANALYTICS_FFTBITS - 1 - b);
+            }
+            bitReverse[i] = static_cast<std::uint16_t>(reversed);
+        }
+        for (std::size_t i = 0; i < twiddles.size(); i++) {
+            twiddles[i] = std::polar(1.f, static_cast<float>(-2. * std::numbers::pi * static_cast<double>(i) / ANALYTICS_FFTSIZE));
+        }
+    }
+};
+
+const FftTables& GetFftTables()
+{
+    static const FftTables tables;
+    return tables;
+}
+
+float ToDb(double power) noexcept
+{
+    return power > 0. ? static_cast<float>(10. * std::log10(power)) : ANALYTICS_SILENCE_DB;
+}
+
+}
+
+USpeakNative::USpeakAnalytics::USpeakAnalytics(std::uint32_t windowMs, float clipThreshold)
+    : m_windowMs(std::max<std::uint32_t>(windowMs, 20))
+    , m_clipThreshold(clipThreshold)
+    , m_players()
+    , m_finished()
+{
+}
+
+void USpeakNative::USpeakAnalytics::analyze(const USpeakPacket& packet)
+{
+    auto it = m_players.find(packet.playerId);
+    if (it == m_players.end()) {
+        it = m_players.emplace(packet.playerId, PlayerWindow {}).first;
+        it->second.windowStart = packet.packetTime;
+        it->second.noiseFloorDb = ANALYTICS_SPEECH_MIN_DB;
+    }
+    PlayerWindow& window = it->second;
+
+    // packetTime may wrap, compare the distance rather than the values
+    if (window.frames > 0 && packet.packetTime - window.windowStart >= m_windowMs) {
+        finishWindow(packet.playerId, window);
+        window.windowStart = packet.packetTime;
+    }
+
+    std::span<const float> samples = packet.audioSamples;
+    for (std::size_t offset = 0; offset + ANALYTICS_FRAMESIZE <= samples.size(); offset += ANALYTICS_FRAMESIZE) {
+        analyzeFrame(window, samples.subspan(offset, ANALYTICS_FRAMESIZE));
+    }
+}
+
+void USpeakNative::USpeakAnalytics::analyze(std::span<const USpeakPacket> packets)
+{
+    for (const USpeakPacket& packet : packets) {
+        analyze(packet);
+    }
+}
+
+std::size_t USpeakNative::USpeakAnalytics::collect(std::vector<AudioWindowMetrics>& metricsOut)
+{
+    std::size_t count = m_finished.size();
+    metricsOut.insert(metricsOut.end(), m_finished.begin(), m_finished.end());
+    m_finished.clear();
+    return count;
+}
+
+void USpeakNative::USpeakAnalytics::flush()
+{
+    for (auto& [playerId, window] : m_players) {
+        if (window.frames > 0) {
+            finishWindow(playerId, window);
+        }
+    }
+}
+
+void USpeakNative::USpeakAnalytics::removePlayer(std::int32_t playerId)
+{
+    auto it = m_players.find(playerId);
+    if (it == m_players.end()) {
+        return;
+    }
+
+    if (it->second.frames > 0) {
+        finishWindow(playerId, it->second);
+    }
+    m_players.erase(it);
+}
+
+void USpeakNative::USpeakAnalytics::clear()
+{
+    m_players.clear();
+    m_finished.clear();
+}
+
+void USpeakNative::USpeakAnalytics::analyzeFrame(PlayerWindow& window, std::span<const float> frame)
+{
+    // Independent lanes let the compiler vectorise the level pass without reassociating floats itself
+    std::array<float, ANALYTICS_LANES> peak = {};
+    std::array<float, ANALYTICS_LANES> sumSquares = {};
+    std::array<std::uint32_t, ANALYTICS_LANES> clipped = {};
+    for (std::size_t i = 0; i < frame.size(); i += ANALYTICS_LANES) {
+        for (std::size_t l = 0; l < ANALYTICS_LANES; l++) {
+            float sample = frame[i + l];
+            float level = std::abs(sample);
+            peak[l] = std::max(peak[l], level);
+            sumSquares[l] += sample * sample;
+            clipped[l] += level >= m_clipThreshold ? 1 : 0;
+        }
+    }
+
+    float framePeak = 0.f;
+    float frameSumSquares = 0.f;
+    for (std::size_t l = 0; l < ANALYTICS_LANES; l++) {
+        framePeak = std::max(framePeak, peak[l]);
+        frameSumSquares += sumSquares[l];
+        window.clippedSamples += clipped[l];
+    }
+
+    window.frames++;
+    window.samples += frame.size();
+    window.peak = std::max(window.peak, framePeak);
+    window.sumSquares += frameSumSquares;
+
+    // Speech is anything clearly above a noise floor that falls instantly and rises slowly
+    float frameDb = ToDb(frameSumSquares / static_cast<float>(frame.size()));
+    window.noiseFloorDb = std::min(window.noiseFloorDb + ANALYTICS_FLOOR_RISE_DB, std::max(frameDb, ANALYTICS_SILENCE_DB));
+    if (frameDb > ANALYTICS_SPEECH_MIN_DB && frameDb > window.noiseFloorDb + ANALYTICS_SPEECH_ABOVE_FLOOR_DB) {
+        window.speechFrames++;
+    }
+
+    if (frameDb <= ANALYTICS_SILENCE_DB) {
+        return;
+    }
+
+    // Coarse spectrum from a Hann windowed FFT over the middle of the frame
+    const FftTables& tables = GetFftTables();
+    std::array<std::complex<float>, ANALYTICS_FFTSIZE> bins;
+    const float* input = frame.data() + (frame.size() - ANALYTICS_FFTSIZE) / 2;
+    for (std::size_t i = 0; i < ANALYTICS_FFTSIZE; i++) {
+        bins[tables.bitReverse[i]] = std::complex<float>(input[i] * tables.window[i], 0.f);
+    }
+    for (std::size_t size = 2; size <= ANALYTICS_FFTSIZE; size *= 2) {
+        std::size_t half = size / 2;
+        std::size_t stride = ANALYTICS_FFTSIZE / size;
+        for (std::size_t start = 0; start < ANALYTICS_FFTSIZE; start += size) {
+            for (std::size_t k = 0; k < half; k++) {
+                std::complex<float> odd = bins[start + k + half] * tables.twiddles[k * stride];
+                bins[start + k + half] = bins[start + k] - odd;
+                bins[start + k] += odd;
+            }
+        }
+    }
+
+    std::size_t bin = 1;
+    for (std::size_t band = 0; band < ANALYTICS_BANDCOUNT; band++) {
+        double energy = 0.;
+        for (; bin < ANALYTICS_BANDEDGES[band]; bin++) {
+            energy += std::norm(bins[bin]);
+        }
+        window.bandEnergy[band] += energy;
+    }
+}
+
+void USpeakNative::USpeakAnalytics::finishWindow(std::int32_t playerId, PlayerWindow& window)
+{
+    // One sided spectrum over the Hann window's energy (3N/8), so the bands add up to the mean square of the signal like rmsDb
+    constexpr double bandScale = 16. / (3. * static_cast<double>(ANALYTICS_FFTSIZE) * ANALYTICS_FFTSIZE);
+
+    AudioWindowMetrics metrics;
+    metrics.playerId = playerId;
+    metrics.windowStart = window.windowStart;
+    metrics.frames = window.frames;
+    metrics.peakDb = ToDb(static_cast<double>(window.peak) * window.peak);
+    metrics.rmsDb = ToDb(window.samples == 0 ? 0. : window.sumSquares / static_cast<double>(window.samples));
+    metrics.clippedSamples = window.clippedSamples;
+    metrics.speechRatio = window.frames == 0 ? 0.f : static_cast<float>(window.speechFrames) / static_cast<float>(window.frames);
+    for (std::size_t band = 0; band < ANALYTICS_BANDCOUNT; band++) {
+        metrics.bandsDb[band] = ToDb(window.frames == 0 ? 0. : window.bandEnergy[band] * bandScale / window.frames);
+    }
+    m_finished.push_back(metrics);
+
+    float noiseFloorDb = window.noiseFloorDb;
+    window = PlayerWindow {};
+    window.noiseFloorDb = noiseFloorDb;
+}
@@ -0,0 +1,66 @@
+#ifndef USPEAK_USPEAKANALYTICS_H
+#define USPEAK_USPEAKANALYTICS_H
+
+#include "uspeakpacket.h"
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+namespace USpeakNative {
+
+constexpr std::size_t ANALYTICS_BANDCOUNT = 8;
+
+// Levels are in dBFS, bands hold the average energy of 0-125, 125-250, 250-500, 500-1k, 1k-2k, 2k-4k, 4k-8k and 8k-24k Hz
+struct AudioWindowMetrics {
+    std::int32_t playerId;
+    std::uint32_t windowStart;
+    std::uint32_t frames;
+    float peakDb;
+    float rmsDb;
+    std::uint32_t clippedSamples;
+    float speechRatio;
+    std::array<float, ANALYTICS_BANDCOUNT> bandsDb;
+};
+
+// Collects level, clipping, speech activity and coarse spectrum per player over windows of packetTime,
+// working on 20ms frames of decoded 48kHz mono audio. Finished windows are buffered until collected.
+class USpeakAnalytics
+{
+public:
+    USpeakAnalytics(std::uint32_t windowMs = 1000, float clipThreshold = 0.99f);
+
+    void analyze(const USpeakNative::USpeakPacket& packet);
+    void analyze(std::span<const USpeakNative::USpeakPacket> packets);
+
+    std::size_t collect(std::vector<USpeakNative::AudioWindowMetrics>& metricsOut);
+    void flush();
+    void removePlayer(std::int32_t playerId);
+    void clear();
+private:
+    struct PlayerWindow {
+        std::uint32_t windowStart;
+        std::uint32_t frames;
+        std::uint32_t speechFrames;
+        std::uint32_t clippedSamples;
+        std::uint64_t samples;
+        float peak;
+        double sumSquares;
+        float noiseFloorDb;
+        std::array<double, ANALYTICS_BANDCOUNT> bandEnergy;
+    };
+
+    void analyzeFrame(PlayerWindow& window, std::span<const float> frame);
+    void finishWindow(std::int32_t playerId, PlayerWindow& window);
+
+    std::uint32_t m_windowMs;
+    float m_clipThreshold;
+    std::unordered_map<std::int32_t, PlayerWindow> m_players;
+    std::vector<USpeakNative::AudioWindowMetrics> m_finished;
+};
+
+}
+
+#endif // USPEAK_USPEAKANALYTICS_H
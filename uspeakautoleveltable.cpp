@@ -0,0 +1,165 @@
+#include "uspeakautoleveltable.h"
+
+#include "uspeakvolume.h"
+
+#include <bit>
+#include <algorithm>
+
+inline std::size_t HashPlayerId(std::int32_t playerId, std::size_t mask) {
+    // Fibonacci hashing, playerIds are mostly small sequential numbers
+    return static_cast<std::size_t>((static_cast<std::uint32_t>(playerId) * 2654435769u) >> 7) & mask;
+}
+
+USpeakNative::AutoLevelTable::AutoLevelTable(float targetRms, std::size_t initialCapacity)
+    : m_targetRms(targetRms)
+    , m_size(0)
+    , m_playerIds(std::bit_ceil(std::max<std::size_t>(initialCapacity, 8)), 0)
+    , m_used(m_playerIds.size(), 0)
+    , m_currentScale(m_playerIds.size(), 1.f)
+    , m_runningScale(m_playerIds.size(), 1.f)
+{
+}
+
+std::size_t USpeakNative::AutoLevelTable::slot(std::int32_t playerId)
+{
+    std::size_t found = find(playerId);
+    if (found != SIZE_MAX) {
+        return found;
+    }
+
+    // Keep the load factor at or below one half so probe sequences stay short
+    if ((m_size + 1) * 2 > m_playerIds.size()) {
+        grow();
+    }
+
+    std::size_t mask = m_playerIds.size() - 1;
+    std::size_t i = HashPlayerId(playerId, mask);
+    while (m_used[i]) {
+        i = (i + 1) & mask;
+    }
+
+    m_playerIds[i] = playerId;
+    m_used[i] = 1;
+    m_currentScale[i] = 1.f;
+    m_runningScale[i] = 1.f;
+    m_size++;
+
+    return i;
+}
+
+bool USpeakNative::AutoLevelTable::erase(std::int32_t playerId) noexcept
+{
+    std::size_t i = find(playerId);
+    if (i == SIZE_MAX) {
+        return false;
+    }
+
+    // Backward shift deletion, moves later members of the probe chain into the hole
+    std::size_t mask = m_playerIds.size() - 1;
+    std::size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!m_used[j]) {
+            break;
+        }
+
+        std::size_t home = HashPlayerId(m_playerIds[j], mask);
+        bool movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable) {
+            m_playerIds[i] = m_playerIds[j];
+            m_currentScale[i] = m_currentScale[j];
+            m_runningScale[i] = m_runningScale[j];
+            i = j;
+        }
+    }
+
+    m_used[i] = 0;
+    m_size--;
+
+    return true;
+}
+
+void USpeakNative::AutoLevelTable::clear() noexcept
+{
+    std::fill(m_used.begin(), m_used.end(), 0);
+    m_size = 0;
+}
+
+std::size_t USpeakNative::AutoLevelTable::size() const noexcept
+{
+    return m_size;
+}
+
+void USpeakNative::AutoLevelTable::apply(std::int32_t playerId, std::span<float> samples)
+{
+    std::size_t i = slot(playerId);
+    float rms = USpeakNative::GetRMS(samples);
+
+    float fromScale, toScale;
+    update(std::span<const std::size_t>(&i, 1), std::span<const float>(&rms, 1), std::span<float>(&fromScale, 1), std::span<float>(&toScale, 1));
+
+    USpeakNative::ApplyGainRamp(samples, fromScale, toScale);
+}
+
+void USpeakNative::AutoLevelTable::update(std::span<const std::size_t> slots, std::span<const float> rms, std::span<float> fromScale, std::span<float> toScale) noexcept
+{
+    float* currentScale = m_currentScale.data();
+    float* runningScale = m_runningScale.data();
+
+    for (std::size_t i = 0; i < slots.size(); i++) {
+        std::size_t s = slots[i];
+        USpeakNative::AutoLevelStep(rms[i], m_targetRms, currentScale[s], runningScale[s], fromScale[i], toScale[i]);
+    }
+}
+
+float USpeakNative::AutoLevelTable::currentScale(std::size_t slot) const noexcept
+{
+    return m_currentScale[slot];
+}
+
+float USpeakNative::AutoLevelTable::runningScale(std::size_t slot) const noexcept
+{
+    return m_runningScale[slot];
+}
+
+std::size_t USpeakNative::AutoLevelTable::find(std::int32_t playerId) const noexcept
+{
+    std::size_t mask = m_playerIds.size() - 1;
+    std::size_t i = HashPlayerId(playerId, mask);
+    while (m_used[i]) {
+        if (m_playerIds[i] == playerId) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return SIZE_MAX;
+}
+
+void USpeakNative::AutoLevelTable::grow()
+{
+    std::vector<std::int32_t> playerIds(m_playerIds.size() * 2, 0);
+    std::vector<std::uint8_t> used(playerIds.size(), 0);
+    std::vector<float> currentScale(playerIds.size(), 1.f);
+    std::vector<float> runningScale(playerIds.size(), 1.f);
+
+    std::size_t mask = playerIds.size() - 1;
+    for (std::size_t i = 0; i < m_playerIds.size(); i++) {
+        if (!m_used[i]) continue;
+
+        std::size_t j = HashPlayerId(m_playerIds[i], mask);
+        while (used[j]) {
+            j = (j + 1) & mask;
+        }
+
+        playerIds[j] = m_playerIds[i];
+        used[j] = 1;
+        currentScale[j] = m_currentScale[i];
+        runningScale[j] = m_runningScale[i];
+    }
+
+    m_playerIds = std::move(playerIds);
+    m_used = std::move(used);
+    m_currentScale = std::move(currentScale);
+    m_runningScale = std::move(runningScale);
+}
@@ -0,0 +1,40 @@
+#ifndef USPEAK_USPEAKAUTOLEVELTABLE_H
+#define USPEAK_USPEAKAUTOLEVELTABLE_H
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace USpeakNative {
+
+// Per-player AutoLevel state, open-addressed by playerId and stored as structure-of-arrays
+class AutoLevelTable
+{
+public:
+    AutoLevelTable(float targetRms = 1.f, std::size_t initialCapacity = 64);
+
+    std::size_t slot(std::int32_t playerId);
+    bool erase(std::int32_t playerId) noexcept;
+    void clear() noexcept;
+    std::size_t size() const noexcept;
+
+    void apply(std::int32_t playerId, std::span<float> samples);
+    void update(std::span<const std::size_t> slots, std::span<const float> rms, std::span<float> fromScale, std::span<float> toScale) noexcept;
+
+    float currentScale(std::size_t slot) const noexcept;
+    float runningScale(std::size_t slot) const noexcept;
+private:
+    std::size_t find(std::int32_t playerId) const noexcept;
+    void grow();
+
+    float m_targetRms;
+    std::size_t m_size;
+    std::vector<std::int32_t> m_playerIds;
+    std::vector<std::uint8_t> m_used;
+    std::vector<float> m_currentScale;
+    std::vector<float> m_runningScale;
+};
+
+}
+
+#endif // USPEAK_USPEAKAUTOLEVELTABLE_H
@@ -0,0 +1,241 @@
+#include "uspeakcapi.h"
+
+#include "uspeaklite.h"
+#include "uspeakpacket.h"
+
+#include "internal/scopedspinlock.h"
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <memory_resource>
+
+static_assert(USPEAK_CAPI_MAX_PACKET_SIZE == USPEAK_BUFFERSIZE, "C API packet size out of sync with USPEAK_BUFFERSIZE");
+static_assert(USPEAK_QUEUE_BLOCK == (int)USpeakNative::QueuePolicy::Block);
+static_assert(USPEAK_QUEUE_DROP_OLDEST == (int)USpeakNative::QueuePolicy::DropOldest);
+static_assert(USPEAK_QUEUE_DROP_NEWEST == (int)USpeakNative::QueuePolicy::DropNewest);
+static_assert(USPEAK_QUEUE_SKIP_TO_LATEST == (int)USpeakNative::QueuePolicy::SkipToLatest);
+
+// Batch state is kept on the handle and only ever grows, so a host decoding steady batches stops allocating after the first call
+struct USpeakHandle {
+    USpeakHandle()
+        : lite()
+        , decodeLock(false)
+        , inputs()
+        , packets()
+        , scratchBuffer()
+        , scratch(scratchBuffer.data(), scratchBuffer.size())
+    {
+    }
+
+    USpeakNative::USpeakLite lite;
+    std::atomic_bool decodeLock;
+    std::vector<std::span<const std::byte>> inputs;
+    std::vector<USpeakNative::USpeakPacket> packets;
+    std::array<std::byte, 16384> scratchBuffer;
+    std::pmr::monotonic_buffer_resource scratch;
+};
+
+int32_t uspeak_api_version(void)
+{
+    return USPEAK_CAPI_VERSION;
+}
+
+int32_t uspeak_create(USpeakHandle** handleOut)
+{
+    if (handleOut == nullptr) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+    *handleOut = nullptr;
+
+    try {
+        *handleOut = new USpeakHandle();
+    } catch (...) {
+        return USPEAK_ERROR_FAILED;
+    }
+
+    return USPEAK_OK;
+}
+
+void uspeak_destroy(USpeakHandle* handle)
+{
+    delete handle;
+}
+
+int32_t uspeak_stream_file(USpeakHandle* handle, const char* filename)
+{
+    if (handle == nullptr || filename == nullptr) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        return handle->lite.streamFile(filename) ? USPEAK_OK : USPEAK_ERROR_FAILED;
+    } catch (...) {
+        return USPEAK_ERROR_FAILED;
+    }
+}
+
+int32_t uspeak_push_samples(USpeakHandle* handle, const float* samples, size_t sampleCount, int32_t sampleRate, int32_t channels, size_t* framesEncodedOut)
+{
+    if (handle == nullptr || (samples == nullptr && sampleCount != 0) || sampleRate <= 0 || channels <= 0) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        std::size_t frames = handle->lite.pushSamples(std::span<const float>(samples, sampleCount), sampleRate, channels);
+        if (framesEncodedOut != nullptr) {
+            *framesEncodedOut = frames;
+        }
+    } catch (...) {
+        return USPEAK_ERROR_FAILED;
+    }
+
+    return USPEAK_OK;
+}
+
+int32_t uspeak_set_queue_limit(USpeakHandle* handle, uint32_t frames, int32_t policy)
+{
+    if (handle == nullptr || policy < USPEAK_QUEUE_BLOCK || policy > USPEAK_QUEUE_SKIP_TO_LATEST) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+
+    handle->lite.setQueueLimitFrames(frames, static_cast<USpeakNative::QueuePolicy>(policy));
+
+    return USPEAK_OK;
+}
+
+int32_t uspeak_remove_player(USpeakHandle* handle, int32_t playerId)
+{
+    if (handle == nullptr) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+
+    try {
+        handle->lite.removePlayer(playerId);
+    } catch (...) {
+        return USPEAK_ERROR_FAILED;
+    }
+
+    return USPEAK_OK;
+}
+
+int32_t uspeak_get_audio_frames(USpeakHandle* handle, int32_t playerId, uint32_t packetTime, uint32_t packetTimeStep,
+                                uint8_t* buffer, size_t bufferSize, uint32_t* packetSizesOut, size_t maxPackets)
+{
+    if (handle == nullptr || buffer == nullptr || packetSizesOut == nullptr) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+    if (maxPackets != 0 && bufferSize < USPEAK_BUFFERSIZE) {
+        return USPEAK_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    std::span<std::byte> out(reinterpret_cast<std::byte*>(buffer), bufferSize);
+    std::size_t offset = 0;
+    std::size_t count = 0;
+
+    try {
+        while (count < maxPackets && out.size() - offset >= USPEAK_BUFFERSIZE) {
+            std::uint32_t time = packetTime + static_cast<std::uint32_t>(count) * packetTimeStep;
+            std::size_t size = handle->lite.getAudioFrame(playerId, time, out.subspan(offset));
+            if (size == 0) {
+                break;
+            }
+
+            packetSizesOut[count++] = static_cast<std::uint32_t>(size);
+            offset += size;
+        }
+    } catch (...) {
+        return USPEAK_ERROR_FAILED;
+    }
+
+    return static_cast<int32_t>(count);
+}
+
+int32_t uspeak_decode_packets(USpeakHandle* handle, const uint8_t* data, const uint32_t* packetSizes, size_t packetCount,
+                              USpeakDecodedPacket* packetsOut, float* samplesOut, size_t sampleCapacity)
+{
+    if (handle == nullptr || (packetCount != 0 && (data == nullptr || packetSizes == nullptr || packetsOut == nullptr)) || (samplesOut == nullptr && sampleCapacity != 0)) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+
+    // The batch state on the handle is shared, concurrent decodes on one handle take turns
+    USpeakNative::Internal::ScopedSpinLock l(handle->decodeLock);
+
+    try {
+        handle->inputs.clear();
+        std::size_t dataOffset = 0;
+        for (std::size_t i = 0; i < packetCount; i++) {
+            handle->inputs.emplace_back(reinterpret_cast<const std::byte*>(data) + dataOffset, packetSizes[i]);
+            dataOffset += packetSizes[i];
+        }
+
+        if (handle->packets.size() < packetCount) {
+            handle->packets.resize(packetCount);
+        }
+
+        handle->scratch.release();
+        handle->lite.decodePackets(handle->inputs, std::span<USpeakNative::USpeakPacket>(handle->packets.data(), packetCount), &handle->scratch);
+
+        std::size_t sampleOffset = 0;
+        std::int32_t decoded = 0;
+        for (std::size_t i = 0; i < packetCount; i++) {
+            const USpeakNative::USpeakPacket& packet = handle->packets[i];
+            USpeakDecodedPacket& result = packetsOut[i];
+
+            result.playerId = packet.playerId;
+            result.packetTime = packet.packetTime;
+            result.sampleOffset = static_cast<uint32_t>(sampleOffset);
+            result.sampleCount = 0;
+
+            if (packet.audioSamples.empty()) {
+                result.status = USPEAK_ERROR_DECODE;
+                continue;
+            }
+            if (sampleCapacity - sampleOffset < packet.audioSamples.size()) {
+                result.status = USPEAK_ERROR_BUFFER_TOO_SMALL;
+                continue;
+            }
+
+            std::memcpy(samplesOut + sampleOffset, packet.audioSamples.data(), packet.audioSamples.size() * sizeof(float));
+            result.sampleCount = static_cast<uint32_t>(packet.audioSamples.size());
+            result.status = USPEAK_OK;
+            sampleOffset += packet.audioSamples.size();
+            decoded++;
+        }
+
+        return decoded;
+    } catch (...) {
+        return USPEAK_ERROR_FAILED;
+    }
+}
+
+int32_t uspeak_get_stats(USpeakHandle* handle, USpeakStats* statsOut)
+{
+    if (handle == nullptr || statsOut == nullptr || statsOut->structSize < sizeof(uint32_t)) {
+        return USPEAK_ERROR_INVALID_ARGUMENT;
+    }
+
+    USpeakNative::FrameQueueStats queue = handle->lite.queueStats();
+    USpeakNative::LiveInputStats live = handle->lite.liveInputStats();
+
+    USpeakStats stats;
+    stats.structSize = statsOut->structSize;
+    stats.encoderComplexity = handle->lite.encoderComplexity();
+    stats.droppedFrames = queue.droppedFrames;
+    stats.framesEncoded = live.framesEncoded;
+    stats.lastLatencyUs = live.lastLatencyUs;
+    stats.maxLatencyUs = live.maxLatencyUs;
+    stats.averageLatencyUs = live.averageLatencyUs;
+    stats.queuedFrames = static_cast<uint32_t>(queue.queuedFrames);
+    stats.queuedMs = queue.queuedMs;
+    stats.highWaterMarkFrames = static_cast<uint32_t>(queue.highWaterMarkFrames);
+    stats.highWaterMarkMs = queue.highWaterMarkMs;
+    stats.durationMs = handle->lite.durationMs();
+    stats.positionMs = handle->lite.positionMs();
+
+    std::memcpy(statsOut, &stats, std::min<std::size_t>(statsOut->structSize, sizeof(USpeakStats)));
+
+    return USPEAK_OK;
+}
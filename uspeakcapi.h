@@ -0,0 +1,101 @@
+#ifndef USPEAK_USPEAKCAPI_H
+#define USPEAK_USPEAKCAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Flat C interface for managed hosts. Every call takes caller-owned (pinned) buffers and works on whole batches,
+// nothing allocated by the library is ever handed across the boundary and no call throws.
+
+#if defined(_WIN32)
+#  if defined(USPEAK_CAPI_EXPORTS)
+#    define USPEAK_CAPI __declspec(dllexport)
+#  else
+#    define USPEAK_CAPI __declspec(dllimport)
+#  endif
+#else
+#  define USPEAK_CAPI __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define USPEAK_CAPI_VERSION 1
+
+// Largest packet uspeak_get_audio_frames writes, reserve this much buffer per packet
+#define USPEAK_CAPI_MAX_PACKET_SIZE 1022
+
+typedef struct USpeakHandle USpeakHandle;
+
+typedef enum USpeakStatus {
+    USPEAK_OK = 0,
+    USPEAK_ERROR_INVALID_ARGUMENT = -1,
+    USPEAK_ERROR_BUFFER_TOO_SMALL = -2,
+    USPEAK_ERROR_DECODE = -3,
+    USPEAK_ERROR_FAILED = -4,
+} USpeakStatus;
+
+typedef enum USpeakQueuePolicy {
+    USPEAK_QUEUE_BLOCK = 0,
+    USPEAK_QUEUE_DROP_OLDEST = 1,
+    USPEAK_QUEUE_DROP_NEWEST = 2,
+    USPEAK_QUEUE_SKIP_TO_LATEST = 3,
+} USpeakQueuePolicy;
+
+// One entry per packet of a uspeak_decode_packets batch, samples live in the caller's sample buffer at sampleOffset
+typedef struct USpeakDecodedPacket {
+    int32_t playerId;
+    uint32_t packetTime;
+    uint32_t sampleOffset;
+    uint32_t sampleCount;
+    int32_t status;
+} USpeakDecodedPacket;
+
+// Set structSize to sizeof(USpeakStats) before calling uspeak_get_stats, older callers get the prefix they know about
+typedef struct USpeakStats {
+    uint32_t structSize;
+    int32_t encoderComplexity;
+    uint64_t droppedFrames;
+    uint64_t framesEncoded;
+    int64_t lastLatencyUs;
+    int64_t maxLatencyUs;
+    int64_t averageLatencyUs;
+    uint32_t queuedFrames;
+    uint32_t queuedMs;
+    uint32_t highWaterMarkFrames;
+    uint32_t highWaterMarkMs;
+    uint32_t durationMs;
+    uint32_t positionMs;
+} USpeakStats;
+
+USPEAK_CAPI int32_t uspeak_api_version(void);
+
+USPEAK_CAPI int32_t uspeak_create(USpeakHandle** handleOut);
+USPEAK_CAPI void uspeak_destroy(USpeakHandle* handle);
+
+// filename is UTF-8
+USPEAK_CAPI int32_t uspeak_stream_file(USpeakHandle* handle, const char* filename);
+USPEAK_CAPI int32_t uspeak_push_samples(USpeakHandle* handle, const float* samples, size_t sampleCount, int32_t sampleRate, int32_t channels, size_t* framesEncodedOut);
+USPEAK_CAPI int32_t uspeak_set_queue_limit(USpeakHandle* handle, uint32_t frames, int32_t policy);
+USPEAK_CAPI int32_t uspeak_remove_player(USpeakHandle* handle, int32_t playerId);
+
+// Packs up to maxPackets outbound packets back to back into buffer, stamping packetTime + i * packetTimeStep.
+// Returns the number of packets written (their sizes are in packetSizesOut) or a negative USpeakStatus.
+USPEAK_CAPI int32_t uspeak_get_audio_frames(USpeakHandle* handle, int32_t playerId, uint32_t packetTime, uint32_t packetTimeStep,
+                                            uint8_t* buffer, size_t bufferSize, uint32_t* packetSizesOut, size_t maxPackets);
+
+// Decodes packetCount packets stored back to back in data, packetSizes[i] bytes each.
+// Decoded samples are appended to samplesOut, a packet that doesn't fit or fails to decode gets a non-zero status and no samples.
+// Returns the number of packets decoded or a negative USpeakStatus.
+// Safe to call from several threads, calls on the same handle are serialized and wait for each other.
+USPEAK_CAPI int32_t uspeak_decode_packets(USpeakHandle* handle, const uint8_t* data, const uint32_t* packetSizes, size_t packetCount,
+                                          USpeakDecodedPacket* packetsOut, float* samplesOut, size_t sampleCapacity);
+
+USPEAK_CAPI int32_t uspeak_get_stats(USpeakHandle* handle, USpeakStats* statsOut);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // USPEAK_USPEAKCAPI_H
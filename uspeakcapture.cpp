@@ -0,0 +1,320 @@
+#include "uspeakcapture.h"
+
+#include "helpers.h"
+#include "uspeakpacket.h"
+#include "internal/scopedspinlock.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+constexpr std::string_view USPEAKCAPTURE_MAGIC = std::string_view("USPKCAP\0", 8);
+constexpr std::string_view USPEAKCAPTURE_INDEXMAGIC = std::string_view("USPKIDX\0", 8);
+constexpr std::uint32_t USPEAKCAPTURE_VERSION = 1;
+constexpr std::size_t USPEAKCAPTURE_HEADERSIZE = 16;
+constexpr std::size_t USPEAKCAPTURE_RECORDHEADERSIZE = sizeof(std::int64_t) + sizeof(std::uint32_t);
+constexpr std::size_t USPEAKCAPTURE_TRAILERSIZE = sizeof(std::uint64_t) + sizeof(std::uint64_t) + 8;
+
+inline bool CompareByTime(const USpeakNative::USpeakCaptureEntry& a, const USpeakNative::USpeakCaptureEntry& b) {
+    return a.receiveTime < b.receiveTime;
+}
+inline bool CompareByPlayer(const USpeakNative::USpeakCaptureEntry& a, const USpeakNative::USpeakCaptureEntry& b) {
+    return a.playerId < b.playerId || (a.playerId == b.playerId && a.receiveTime < b.receiveTime);
+}
+
+USpeakNative::USpeakCaptureWriter::USpeakCaptureWriter()
+    : m_lock(false)
+    , m_file()
+    , m_offset(0)
+    , m_entries()
+{
+}
+
+USpeakNative::USpeakCaptureWriter::~USpeakCaptureWriter()
+{
+    close();
+}
+
+bool USpeakNative::USpeakCaptureWriter::open(std::string_view filename)
+{
+    close();
+
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    m_file.open(std::string(filename), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        fmt::print("[USpeakNative] Capture: Failed to open {}!\n", filename);
+        return false;
+    }
+
+    std::array<std::byte, USPEAKCAPTURE_HEADERSIZE> header{};
+    std::memcpy(header.data(), USPEAKCAPTURE_MAGIC.data(), USPEAKCAPTURE_MAGIC.size());
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 8, USPEAKCAPTURE_VERSION);
+    m_file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    m_offset = header.size();
+    m_entries.clear();
+
+    return m_file.good();
+}
+
+bool USpeakNative::USpeakCaptureWriter::append(std::span<const std::byte> packet)
+{
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return append(packet, std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+bool USpeakNative::USpeakCaptureWriter::append(std::span<const std::byte> packet, std::int64_t receiveTime)
+{
+    if (packet.size() < USPEAK_HEADERSIZE || packet.size() > UINT32_MAX) {
+        return false;
+    }
+
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    std::array<std::byte, USPEAKCAPTURE_RECORDHEADERSIZE> recordHeader;
+    USpeakNative::Helpers::ConvertToBytes<std::int64_t>(recordHeader.data(), 0, receiveTime);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(recordHeader.data(), 8, static_cast<std::uint32_t>(packet.size()));
+    m_file.write(reinterpret_cast<const char*>(recordHeader.data()), recordHeader.size());
+    m_file.write(reinterpret_cast<const char*>(packet.data()), packet.size());
+
+    m_entries.push_back(USpeakCaptureEntry {
+        receiveTime,
+        USpeakNative::Helpers::ConvertFromBytes<std::int32_t>(packet.data(), 0),
+        USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(packet.data(), 4),
+        m_offset
+    });
+    m_offset += recordHeader.size() + packet.size();
+
+    return m_file.good();
+}
+
+bool USpeakNative::USpeakCaptureWriter::close()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    // Align the index so the reader can use it in place
+    std::array<std::byte, 8> padding{};
+    std::size_t paddingSize = (8 - (m_offset % 8)) % 8;
+    m_file.write(reinterpret_cast<const char*>(padding.data()), paddingSize);
+    std::uint64_t footerOffset = m_offset + paddingSize;
+
+    std::stable_sort(m_entries.begin(), m_entries.end(), CompareByTime);
+    m_file.write(reinterpret_cast<const char*>(m_entries.data()), m_entries.size() * sizeof(USpeakCaptureEntry));
+
+    std::stable_sort(m_entries.begin(), m_entries.end(), CompareByPlayer);
+    m_file.write(reinterpret_cast<const char*>(m_entries.data()), m_entries.size() * sizeof(USpeakCaptureEntry));
+
+    std::array<std::byte, USPEAKCAPTURE_TRAILERSIZE> trailer;
+    USpeakNative::Helpers::ConvertToBytes<std::uint64_t>(trailer.data(), 0, m_entries.size());
+    USpeakNative::Helpers::ConvertToBytes<std::uint64_t>(trailer.data(), 8, footerOffset);
+    std::memcpy(trailer.data() + 16, USPEAKCAPTURE_INDEXMAGIC.data(), USPEAKCAPTURE_INDEXMAGIC.size());
+    m_file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+
+    bool ok = m_file.good();
+
+    m_file.close();
+    m_entries.clear();
+    m_offset = 0;
+
+    return ok;
+}
+
+USpeakNative::USpeakCaptureReader::USpeakCaptureReader()
+    : m_file()
+    , m_byTime()
+    , m_byPlayer()
+    , m_rebuiltByTime()
+    , m_rebuiltByPlayer()
+{
+}
+
+bool USpeakNative::USpeakCaptureReader::open(std::string_view filename)
+{
+    close();
+
+    if (!m_file.open(filename)) {
+        fmt::print("[USpeakNative] Capture: Failed to open {}!\n", filename);
+        return false;
+    }
+
+    auto data = m_file.data();
+    if (data.size() < USPEAKCAPTURE_HEADERSIZE || std::memcmp(data.data(), USPEAKCAPTURE_MAGIC.data(), USPEAKCAPTURE_MAGIC.size()) != 0) {
+        fmt::print("[USpeakNative] Capture: {} is not a capture file!\n", filename);
+        close();
+        return false;
+    }
+
+    if (USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), 8) != USPEAKCAPTURE_VERSION) {
+        fmt::print("[USpeakNative] Capture: Unsupported capture version!\n");
+        close();
+        return false;
+    }
+
+    if (!readFooter()) {
+        fmt::print("[USpeakNative] Capture: No index found, rebuilding...\n");
+        return rebuildIndex();
+    }
+
+    return true;
+}
+
+void USpeakNative::USpeakCaptureReader::close()
+{
+    m_byTime = {};
+    m_byPlayer = {};
+    m_rebuiltByTime.clear();
+    m_rebuiltByPlayer.clear();
+    m_file.close();
+}
+
+std::size_t USpeakNative::USpeakCaptureReader::size() const noexcept
+{
+    return m_byTime.size();
+}
+
+// True if a whole record, header and packet, starts at offset and ends at or before end
+static bool RecordInBounds(std::span<const std::byte> data, std::uint64_t offset, std::uint64_t end) noexcept
+{
+    if (offset < USPEAKCAPTURE_HEADERSIZE || end > data.size() || offset > end || end - offset < USPEAKCAPTURE_RECORDHEADERSIZE) {
+        return false;
+    }
+
+    std::uint32_t length = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), offset + 8);
+    return length <= end - offset - USPEAKCAPTURE_RECORDHEADERSIZE;
+}
+
+USpeakNative::USpeakCaptureRecord USpeakNative::USpeakCaptureReader::record(const USpeakCaptureEntry& entry) const noexcept
+{
+    auto data = m_file.data();
+    if (!RecordInBounds(data, entry.offset, data.size())) {
+        return USpeakCaptureRecord { entry.receiveTime, {} };
+    }
+
+    std::uint32_t length = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), entry.offset + 8);
+
+    return USpeakCaptureRecord {
+        entry.receiveTime,
+        data.subspan(entry.offset + USPEAKCAPTURE_RECORDHEADERSIZE, length)
+    };
+}
+
+std::span<const USpeakNative::USpeakCaptureEntry> USpeakNative::USpeakCaptureReader::entries() const noexcept
+{
+    return m_byTime;
+}
+
+std::span<const USpeakNative::USpeakCaptureEntry> USpeakNative::USpeakCaptureReader::entries(std::int64_t fromTime) const noexcept
+{
+    USpeakCaptureEntry key{};
+    key.receiveTime = fromTime;
+    auto it = std::lower_bound(m_byTime.begin(), m_byTime.end(), key, CompareByTime);
+
+    return m_byTime.subspan(static_cast<std::size_t>(it - m_byTime.begin()));
+}
+
+std::span<const USpeakNative::USpeakCaptureEntry> USpeakNative::USpeakCaptureReader::playerEntries(std::int32_t playerId) const noexcept
+{
+    return playerEntries(playerId, INT64_MIN);
+}
+
+std::span<const USpeakNative::USpeakCaptureEntry> USpeakNative::USpeakCaptureReader::playerEntries(std::int32_t playerId, std::int64_t fromTime) const noexcept
+{
+    USpeakCaptureEntry first{};
+    first.receiveTime = fromTime;
+    first.playerId = playerId;
+
+    USpeakCaptureEntry last = first;
+    last.receiveTime = INT64_MAX;
+
+    auto begin = std::lower_bound(m_byPlayer.begin(), m_byPlayer.end(), first, CompareByPlayer);
+    auto end = std::upper_bound(begin, m_byPlayer.end(), last, CompareByPlayer);
+
+    return std::span<const USpeakCaptureEntry>(begin, end);
+}
+
+bool USpeakNative::USpeakCaptureReader::readFooter()
+{
+    auto data = m_file.data();
+    if (data.size() < USPEAKCAPTURE_HEADERSIZE + USPEAKCAPTURE_TRAILERSIZE) {
+        return false;
+    }
+
+    auto trailer = data.last(USPEAKCAPTURE_TRAILERSIZE);
+    if (std::memcmp(trailer.data() + 16, USPEAKCAPTURE_INDEXMAGIC.data(), USPEAKCAPTURE_INDEXMAGIC.size()) != 0) {
+        return false;
+    }
+
+    std::uint64_t count = USpeakNative::Helpers::ConvertFromBytes<std::uint64_t>(trailer.data(), 0);
+    std::uint64_t footerOffset = USpeakNative::Helpers::ConvertFromBytes<std::uint64_t>(trailer.data(), 8);
+
+    std::uint64_t footerEnd = data.size() - USPEAKCAPTURE_TRAILERSIZE;
+    if (footerOffset % alignof(USpeakCaptureEntry) != 0 || footerOffset < USPEAKCAPTURE_HEADERSIZE || footerOffset > footerEnd) {
+        return false;
+    }
+
+    // Divide rather than multiply the count, a hostile count would overflow the product
+    std::uint64_t footerSize = footerEnd - footerOffset;
+    if (footerSize % (2 * sizeof(USpeakCaptureEntry)) != 0 || footerSize / (2 * sizeof(USpeakCaptureEntry)) != count) {
+        return false;
+    }
+
+    // Every entry has to point into the records region, otherwise the index is rebuilt from the records.
+    // Only the footer is read here, record() checks the length of a record when it is used so opening doesn't touch every record.
+    auto entries = reinterpret_cast<const USpeakCaptureEntry*>(data.data() + footerOffset);
+    for (std::uint64_t i = 0; i < count * 2; i++) {
+        if (entries[i].offset < USPEAKCAPTURE_HEADERSIZE || entries[i].offset >= footerOffset) {
+            return false;
+        }
+    }
+    m_byTime = std::span<const USpeakCaptureEntry>(entries, count);
+    m_byPlayer = std::span<const USpeakCaptureEntry>(entries + count, count);
+
+    return true;
+}
+
+bool USpeakNative::USpeakCaptureReader::rebuildIndex()
+{
+    auto data = m_file.data();
+
+    std::uint64_t offset = USPEAKCAPTURE_HEADERSIZE;
+    while (offset + USPEAKCAPTURE_RECORDHEADERSIZE <= data.size()) {
+        std::int64_t receiveTime = USpeakNative::Helpers::ConvertFromBytes<std::int64_t>(data.data(), offset);
+        std::uint32_t length = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), offset + 8);
+
+        // Stop at a record cut short by a crash
+        if (length < USPEAK_HEADERSIZE || offset + USPEAKCAPTURE_RECORDHEADERSIZE + length > data.size()) {
+            break;
+        }
+
+        auto packet = data.subspan(offset + USPEAKCAPTURE_RECORDHEADERSIZE, length);
+        m_rebuiltByTime.push_back(USpeakCaptureEntry {
+            receiveTime,
+            USpeakNative::Helpers::ConvertFromBytes<std::int32_t>(packet.data(), 0),
+            USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(packet.data(), 4),
+            offset
+        });
+
+        offset += USPEAKCAPTURE_RECORDHEADERSIZE + length;
+    }
+
+    m_rebuiltByPlayer = m_rebuiltByTime;
+    std::stable_sort(m_rebuiltByTime.begin(), m_rebuiltByTime.end(), CompareByTime);
+    std::stable_sort(m_rebuiltByPlayer.begin(), m_rebuiltByPlayer.end(), CompareByPlayer);
+
+    m_byTime = m_rebuiltByTime;
+    m_byPlayer = m_rebuiltByPlayer;
+
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef USPEAK_USPEAKCAPTURE_H
+#define USPEAK_USPEAKCAPTURE_H
+
+#include "internal/mappedfile.h"
+
+#include <span>
+#include <atomic>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <string_view>
+
+namespace USpeakNative {
+
+// Capture file layout (little endian):
+//   header:  "USPKCAP\0", u32 version, u32 reserved
+//   records: i64 receiveTime (microseconds), u32 length, raw USpeak packet
+//   footer:  entries sorted by time, entries sorted by (playerId, time), u64 count, u64 footer offset, "USPKIDX\0"
+// A capture that was never closed has no footer, the reader then rebuilds the index by scanning the records.
+
+struct USpeakCaptureEntry {
+    std::int64_t receiveTime;
+    std::int32_t playerId;
+    std::uint32_t packetTime;
+    std::uint64_t offset;
+};
+static_assert(sizeof(USpeakCaptureEntry) == 24);
+
+struct USpeakCaptureRecord {
+    std::int64_t receiveTime;
+    std::span<const std::byte> packet;
+};
+
+class USpeakCaptureWriter
+{
+public:
+    USpeakCaptureWriter();
+    ~USpeakCaptureWriter();
+
+    bool open(std::string_view filename);
+    bool append(std::span<const std::byte> packet);
+    bool append(std::span<const std::byte> packet, std::int64_t receiveTime);
+    bool close();
+private:
+    std::atomic_bool m_lock;
+    std::fstream m_file;
+    std::uint64_t m_offset;
+    std::vector<USpeakCaptureEntry> m_entries;
+};
+
+class USpeakCaptureReader
+{
+public:
+    USpeakCaptureReader();
+
+    bool open(std::string_view filename);
+    void close();
+
+    std::size_t size() const noexcept;
+    USpeakCaptureRecord record(const USpeakCaptureEntry& entry) const noexcept;
+
+    std::span<const USpeakCaptureEntry> entries() const noexcept;
+    std::span<const USpeakCaptureEntry> entries(std::int64_t fromTime) const noexcept;
+    std::span<const USpeakCaptureEntry> playerEntries(std::int32_t playerId) const noexcept;
+    std::span<const USpeakCaptureEntry> playerEntries(std::int32_t playerId, std::int64_t fromTime) const noexcept;
+private:
+    bool readFooter();
+    bool rebuildIndex();
+
+    USpeakNative::Internal::MappedFile m_file;
+    std::span<const USpeakCaptureEntry> m_byTime;
+    std::span<const USpeakCaptureEntry> m_byPlayer;
+    std::vector<USpeakCaptureEntry> m_rebuiltByTime;
+    std::vector<USpeakCaptureEntry> m_rebuiltByPlayer;
+};
+
+}
+
+#endif // USPEAK_USPEAKCAPTURE_H
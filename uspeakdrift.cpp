@@ -0,0 +1,107 @@
+#include "uspeakdrift.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+constexpr double DRIFT_FORGET = 0.97;      // Per window, roughly a minute of memory with 2 second windows
+constexpr double DRIFT_MAX = 0.005;        // Never stretch by more than 0.5%, well below audible pitch change
+constexpr double DRIFT_CORRECTION = 1e-4;  // Removes 1ms of buffer error every 10 seconds
+constexpr double DRIFT_SAMPLES_PER_MS = 48.;
+
+USpeakNative::DriftCompensator::DriftCompensator(std::uint32_t windowMs)
+    : m_resampler()
+    , m_windowMs(std::max<std::uint32_t>(windowMs, 100))
+{
+    reset();
+}
+
+void USpeakNative::DriftCompensator::reset() noexcept
+{
+    m_resampler.reset();
+    m_resampler.setRatio(1.);
+
+    m_started = false;
+    m_lastPacketTime = 0;
+    m_senderMs = 0.;
+    m_windowStartMs = 0.;
+    m_windowMinOffsetMs = std::numeric_limits<double>::infinity();
+    m_anchorOffsetMs = 0.;
+    m_windows = 0;
+    m_s0 = m_st = m_so = m_stt = m_sto = 0.;
+    m_drift = 0.;
+    m_accumulatedDriftMs = 0.;
+    m_stretchedMs = 0.;
+    m_stretch = 1.;
+}
+
+void USpeakNative::DriftCompensator::update(std::uint32_t packetTime, std::int64_t arrivalUs) noexcept
+{
+    // Unwrap packetTime, it is allowed to wrap around and packets may arrive out of order
+    if (!m_started) {
+        m_started = true;
+        m_lastPacketTime = packetTime;
+    }
+    m_senderMs += static_cast<double>(static_cast<std::int32_t>(packetTime - m_lastPacketTime));
+    m_lastPacketTime = packetTime;
+
+    double offsetMs = static_cast<double>(arrivalUs) / 1000. - m_senderMs;
+    m_windowMinOffsetMs = std::min(m_windowMinOffsetMs, offsetMs);
+
+    if (m_senderMs - m_windowStartMs < m_windowMs) {
+        return;
+    }
+
+    addWindow(m_senderMs, m_windowMinOffsetMs);
+    m_windowStartMs = m_senderMs;
+    m_windowMinOffsetMs = std::numeric_limits<double>::infinity();
+}
+
+void USpeakNative::DriftCompensator::addWindow(double senderMs, double offsetMs) noexcept
+{
+    if (m_windows++ == 0) {
+        m_anchorOffsetMs = offsetMs;
+    }
+
+    m_s0 = m_s0 * DRIFT_FORGET + 1.;
+    m_st = m_st * DRIFT_FORGET + senderMs;
+    m_so = m_so * DRIFT_FORGET + offsetMs;
+    m_stt = m_stt * DRIFT_FORGET + senderMs * senderMs;
+    m_sto = m_sto * DRIFT_FORGET + senderMs * offsetMs;
+
+    double denominator = m_s0 * m_stt - m_st * m_st;
+    if (m_windows >= 3 && denominator > 0.) {
+        m_drift = std::clamp((m_s0 * m_sto - m_st * m_so) / denominator, -DRIFT_MAX, DRIFT_MAX);
+    }
+
+    // Packets arriving later than they used to means our side consumed faster than the sender produced, the buffer shrank by that much
+    m_accumulatedDriftMs = offsetMs - m_anchorOffsetMs;
+
+    m_stretch = std::clamp(1. + m_drift + bufferErrorMs() * DRIFT_CORRECTION, 1. - DRIFT_MAX, 1. + DRIFT_MAX);
+    m_resampler.setRatio(1. / m_stretch);
+}
+
+void USpeakNative::DriftCompensator::process(std::span<const float> samples, std::vector<float>& samplesOut)
+{
+    samplesOut.clear();
+    samplesOut.reserve(static_cast<std::size_t>(static_cast<double>(samples.size()) * m_stretch) + 2);
+
+    m_resampler.process(samples, [&samplesOut](float sample) { samplesOut.push_back(sample); });
+
+    m_stretchedMs += (static_cast<double>(samplesOut.size()) - static_cast<double>(samples.size())) / DRIFT_SAMPLES_PER_MS;
+}
+
+double USpeakNative::DriftCompensator::driftPpm() const noexcept
+{
+    return m_drift * 1e6;
+}
+
+double USpeakNative::DriftCompensator::bufferErrorMs() const noexcept
+{
+    return m_accumulatedDriftMs - m_stretchedMs;
+}
+
+double USpeakNative::DriftCompensator::stretch() const noexcept
+{
+    return m_stretch;
+}
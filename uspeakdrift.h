@@ -0,0 +1,58 @@
+#ifndef USPEAK_USPEAKDRIFT_H
+#define USPEAK_USPEAKDRIFT_H
+
+#include "uspeakresampler.h"
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace USpeakNative {
+
+// Estimates how fast a sender's clock runs against ours from packetTime versus local arrival time,
+// and stretches or compresses that sender's decoded audio by a few hundred ppm so the buffered latency stays where it started.
+class DriftCompensator
+{
+public:
+    DriftCompensator(std::uint32_t windowMs = 2000);
+
+    void reset() noexcept;
+
+    void update(std::uint32_t packetTime, std::int64_t arrivalUs) noexcept;
+    void process(std::span<const float> samples, std::vector<float>& samplesOut);
+
+    double driftPpm() const noexcept;
+    double bufferErrorMs() const noexcept;
+    double stretch() const noexcept;
+private:
+    void addWindow(double senderMs, double offsetMs) noexcept;
+
+    USpeakNative::StreamResampler m_resampler;
+    std::uint32_t m_windowMs;
+
+    bool m_started;
+    std::uint32_t m_lastPacketTime;
+    double m_senderMs;
+
+    // Smallest arrival offset seen in the current window, jitter only ever adds delay so the minimum tracks the clock
+    double m_windowStartMs;
+    double m_windowMinOffsetMs;
+    double m_anchorOffsetMs;
+    std::size_t m_windows;
+
+    // Exponentially forgetting least squares fit of window minimums against sender time
+    double m_s0;
+    double m_st;
+    double m_so;
+    double m_stt;
+    double m_sto;
+
+    double m_drift;
+    double m_accumulatedDriftMs;
+    double m_stretchedMs;
+    double m_stretch;
+};
+
+}
+
+#endif // USPEAK_USPEAKDRIFT_H
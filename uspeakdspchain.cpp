@@ -0,0 +1,261 @@
+#include "uspeakdspchain.h"
+
+#include <cmath>
+#include <chrono>
+#include <numbers>
+#include <algorithm>
+
+constexpr float GATE_DETECTOR_RELEASE_MS = 20.f;
+
+static float DbToGain(float db) noexcept
+{
+    return std::pow(10.f, db / 20.f);
+}
+
+static float TimeCoefficient(float ms, int sampleRate) noexcept
+{
+    // One pole smoothing coefficient that covers ~63% of a step within ms
+    if (ms <= 0.f) return 1.f;
+    return 1.f - std::exp(-1000.f / (ms * static_cast<float>(sampleRate)));
+}
+
+USpeakNative::GainStage::GainStage(float gainDb)
+    : m_gain(DbToGain(gainDb))
+    , m_currentGain(m_gain)
+{
+}
+
+void USpeakNative::GainStage::setGainDb(float gainDb) noexcept
+{
+    m_gain = DbToGain(gainDb);
+}
+
+const char* USpeakNative::GainStage::name() const noexcept
+{
+    return "Gain";
+}
+
+void USpeakNative::GainStage::reset() noexcept
+{
+    m_currentGain = m_gain;
+}
+
+void USpeakNative::GainStage::process(std::span<float> block) noexcept
+{
+    if (m_currentGain == m_gain) {
+        if (m_gain != 1.f) {
+            for (float& sample : block) {
+                sample *= m_gain;
+            }
+        }
+        return;
+    }
+
+    // Ramp over the whole block when the gain changed so there is no zipper noise, the last sample lands on the new gain
+    float gain = m_currentGain;
+    float step = (m_gain - m_currentGain) / static_cast<float>(block.size());
+    for (float& sample : block) {
+        gain += step;
+        sample *= gain;
+    }
+    m_currentGain = m_gain;
+}
+
+USpeakNative::HighPassStage::HighPassStage(float cutoffHz, int sampleRate)
+{
+    double w0 = 2. * std::numbers::pi * cutoffHz / sampleRate;
+    double alpha = std::sin(w0) / std::numbers::sqrt2; // Q = 1/sqrt(2)
+    double cosw0 = std::cos(w0);
+    double a0 = 1. + alpha;
+
+    m_b0 = static_cast<float>((1. + cosw0) / 2. / a0);
+    m_b1 = static_cast<float>(-(1. + cosw0) / a0);
+    m_b2 = m_b0;
+    m_a1 = static_cast<float>(-2. * cosw0 / a0);
+    m_a2 = static_cast<float>((1. - alpha) / a0);
+
+    reset();
+}
+
+const char* USpeakNative::HighPassStage::name() const noexcept
+{
+    return "HighPass";
+}
+
+void USpeakNative::HighPassStage::reset() noexcept
+{
+    m_z1 = 0.f;
+    m_z2 = 0.f;
+}
+
+void USpeakNative::HighPassStage::process(std::span<float> block) noexcept
+{
+    // Transposed direct form II, state kept in locals for the duration of the block
+    float z1 = m_z1;
+    float z2 = m_z2;
+    for (float& sample : block) {
+        float in = sample;
+        float out = m_b0 * in + z1;
+        z1 = m_b1 * in - m_a1 * out + z2;
+        z2 = m_b2 * in - m_a2 * out;
+        sample = out;
+    }
+    m_z1 = z1;
+    m_z2 = z2;
+}
+
+USpeakNative::NoiseGateStage::NoiseGateStage(float thresholdDb, float attackMs, float releaseMs, int sampleRate)
+    : m_threshold(DbToGain(thresholdDb))
+    , m_attack(TimeCoefficient(attackMs, sampleRate))
+    , m_release(TimeCoefficient(releaseMs, sampleRate))
+    , m_detectorRelease(TimeCoefficient(GATE_DETECTOR_RELEASE_MS, sampleRate))
+    , m_envelope(0.f)
+    , m_gain(0.f)
+{
+}
+
+const char* USpeakNative::NoiseGateStage::name() const noexcept
+{
+    return "NoiseGate";
+}
+
+void USpeakNative::NoiseGateStage::reset() noexcept
+{
+    m_envelope = 0.f;
+    m_gain = 0.f;
+}
+
+void USpeakNative::NoiseGateStage::process(std::span<float> block) noexcept
+{
+    float envelope = m_envelope;
+    float gain = m_gain;
+    for (float& sample : block) {
+        float level = std::abs(sample);
+        envelope += (level - envelope) * (level > envelope ? m_attack : m_detectorRelease);
+
+        float target = envelope >= m_threshold ? 1.f : 0.f;
+        gain += (target - gain) * (target > gain ? m_attack : m_release);
+
+        sample *= gain;
+    }
+    m_envelope = envelope;
+    m_gain = gain;
+}
+
+USpeakNative::LimiterStage::LimiterStage(float ceilingDb, float releaseMs, int sampleRate)
+    : m_ceiling(DbToGain(ceilingDb))
+    , m_release(TimeCoefficient(releaseMs, sampleRate))
+    , m_gain(1.f)
+{
+}
+
+const char* USpeakNative::LimiterStage::name() const noexcept
+{
+    return "Limiter";
+}
+
+void USpeakNative::LimiterStage::reset() noexcept
+{
+    m_gain = 1.f;
+}
+
+void USpeakNative::LimiterStage::process(std::span<float> block) noexcept
+{
+    float gain = m_gain;
+    for (float& sample : block) {
+        gain += (1.f - gain) * m_release;
+
+        float level = std::abs(sample) * gain;
+        if (level > m_ceiling) {
+            gain *= m_ceiling / level;
+        }
+
+        sample *= gain;
+    }
+    m_gain = gain;
+}
+
+USpeakNative::DspChain::DspChain(int inputSampleRate, int outputSampleRate, std::uint32_t blockMs)
+    : m_inputSampleRate(inputSampleRate)
+    , m_outputSampleRate(outputSampleRate)
+    , m_resampler(inputSampleRate, outputSampleRate)
+    , m_block(std::max<std::size_t>(static_cast<std::size_t>(outputSampleRate) * blockMs / 1000, 1))
+    , m_blockFill(0)
+    , m_stages()
+{
+}
+
+void USpeakNative::DspChain::addStage(std::unique_ptr<DspStage> stage)
+{
+    if (stage != nullptr) {
+        m_stages.push_back(StageEntry { std::move(stage), 0, 0 });
+    }
+}
+
+void USpeakNative::DspChain::clearStages()
+{
+    m_stages.clear();
+}
+
+std::size_t USpeakNative::DspChain::stageCount() const noexcept
+{
+    return m_stages.size();
+}
+
+void USpeakNative::DspChain::setInputSampleRate(int sampleRate)
+{
+    if (sampleRate <= 0 || sampleRate == m_inputSampleRate) {
+        return;
+    }
+
+    m_inputSampleRate = sampleRate;
+    m_resampler.setRates(sampleRate, m_outputSampleRate);
+    m_resampler.reset();
+}
+
+std::size_t USpeakNative::DspChain::blockSize() const noexcept
+{
+    return m_block.size();
+}
+
+void USpeakNative::DspChain::reset()
+{
+    m_resampler.reset();
+    m_blockFill = 0;
+    for (StageEntry& entry : m_stages) {
+        entry.stage->reset();
+    }
+}
+
+void USpeakNative::DspChain::processBlock(std::span<float> block) noexcept
+{
+    for (StageEntry& entry : m_stages) {
+        auto start = std::chrono::steady_clock::now();
+        entry.stage->process(block);
+        entry.totalNs += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        entry.blocks++;
+    }
+}
+
+void USpeakNative::DspChain::process(std::span<const float> samples, std::vector<float>& samplesOut)
+{
+    process(samples, [&samplesOut](std::span<const float> block) { samplesOut.insert(samplesOut.end(), block.begin(), block.end()); });
+}
+
+std::vector<USpeakNative::DspStageStats> USpeakNative::DspChain::stats() const
+{
+    std::vector<USpeakNative::DspStageStats> stats;
+    stats.reserve(m_stages.size());
+    for (const StageEntry& entry : m_stages) {
+        stats.push_back(DspStageStats { entry.stage->name(), entry.blocks, entry.totalNs });
+    }
+    return stats;
+}
+
+void USpeakNative::DspChain::resetStats() noexcept
+{
+    for (StageEntry& entry : m_stages) {
+        entry.blocks = 0;
+        entry.totalNs = 0;
+    }
+}
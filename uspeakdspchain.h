@@ -0,0 +1,173 @@
+#ifndef USPEAK_USPEAKDSPCHAIN_H
+#define USPEAK_USPEAKDSPCHAIN_H
+
+#include "uspeakresampler.h"
+
+#include <span>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace USpeakNative {
+
+// A processing step that works in place on one mono block at a time and keeps its own state between blocks
+class DspStage
+{
+public:
+    virtual ~DspStage() = default;
+
+    virtual const char* name() const noexcept = 0;
+    virtual void reset() noexcept = 0;
+    virtual void process(std::span<float> block) noexcept = 0;
+};
+
+class GainStage : public DspStage
+{
+public:
+    GainStage(float gainDb = 0.f);
+
+    void setGainDb(float gainDb) noexcept;
+
+    const char* name() const noexcept override;
+    void reset() noexcept override;
+    void process(std::span<float> block) noexcept override;
+private:
+    float m_gain;
+    float m_currentGain;
+};
+
+// Second order Butterworth high-pass, mainly to strip rumble and DC before encoding
+class HighPassStage : public DspStage
+{
+public:
+    HighPassStage(float cutoffHz = 80.f, int sampleRate = 48000);
+
+    const char* name() const noexcept override;
+    void reset() noexcept override;
+    void process(std::span<float> block) noexcept override;
+private:
+    float m_b0, m_b1, m_b2, m_a1, m_a2;
+    float m_z1, m_z2;
+};
+
+class NoiseGateStage : public DspStage
+{
+public:
+    NoiseGateStage(float thresholdDb = -50.f, float attackMs = 1.f, float releaseMs = 150.f, int sampleRate = 48000);
+
+    const char* name() const noexcept override;
+    void reset() noexcept override;
+    void process(std::span<float> block) noexcept override;
+private:
+    float m_threshold;
+    float m_attack;
+    float m_release;
+    float m_detectorRelease;
+    float m_envelope;
+    float m_gain;
+};
+
+// Peak limiter without lookahead, the gain drops instantly and recovers over releaseMs
+class LimiterStage : public DspStage
+{
+public:
+    LimiterStage(float ceilingDb = -1.f, float releaseMs = 50.f, int sampleRate = 48000);
+
+    const char* name() const noexcept override;
+    void reset() noexcept override;
+    void process(std::span<float> block) noexcept override;
+private:
+    float m_ceiling;
+    float m_release;
+    float m_gain;
+};
+
+struct DspStageStats {
+    const char* name;
+    std::uint64_t blocks;
+    std::uint64_t totalNs;
+};
+
+// Runs every stage over one block before moving on to the next, so the block stays in L1 cache and each added stage costs compute but no extra pass over memory.
+// Input at any sample rate goes through the resampler first and is cut into blocks of blockMs at the output rate.
+class DspChain
+{
+public:
+    DspChain(int inputSampleRate = 48000, int outputSampleRate = 48000, std::uint32_t blockMs = 20);
+
+    template <typename Stage, typename... Args>
+    Stage& addStage(Args&&... args) {
+        auto stage = std::make_unique<Stage>(std::forward<Args>(args)...);
+        Stage& ref = *stage;
+        addStage(std::move(stage));
+        return ref;
+    }
+    void addStage(std::unique_ptr<DspStage> stage);
+    void clearStages();
+    std::size_t stageCount() const noexcept;
+
+    void setInputSampleRate(int sampleRate);
+    std::size_t blockSize() const noexcept;
+
+    void reset();
+
+    void processBlock(std::span<float> block) noexcept;
+
+    template <typename Sink>
+    void process(std::span<const float> samples, Sink&& sink) {
+        auto push = [this, &sink](float sample) {
+            m_block[m_blockFill++] = sample;
+            if (m_blockFill == m_block.size()) {
+                m_blockFill = 0;
+                processBlock(m_block);
+                sink(std::span<const float>(m_block));
+            }
+        };
+
+        if (m_inputSampleRate == m_outputSampleRate) {
+            for (float sample : samples) {
+                push(sample);
+            }
+        } else {
+            m_resampler.process(samples, push);
+        }
+    }
+    void process(std::span<const float> samples, std::vector<float>& samplesOut);
+
+    // Pads a partly filled block with silence and runs it, for the end of a stream
+    template <typename Sink>
+    void flush(Sink&& sink) {
+        if (m_blockFill == 0) {
+            return;
+        }
+        std::fill(m_block.begin() + static_cast<std::ptrdiff_t>(m_blockFill), m_block.end(), 0.f);
+        m_blockFill = 0;
+        processBlock(m_block);
+        sink(std::span<const float>(m_block));
+    }
+
+    std::vector<USpeakNative::DspStageStats> stats() const;
+    void resetStats() noexcept;
+private:
+    struct StageEntry {
+        std::unique_ptr<DspStage> stage;
+        std::uint64_t blocks;
+        std::uint64_t totalNs;
+    };
+
+    int m_inputSampleRate;
+    int m_outputSampleRate;
+    USpeakNative::StreamResampler m_resampler;
+    std::vector<float> m_block;
+    std::size_t m_blockFill;
+    std::vector<StageEntry> m_stages;
+};
+
+// Adds the stages to a freshly made chain, so every stream that needs one can get its own with no state shared between them
+using DspChainSetup = std::function<void(USpeakNative::DspChain& chain)>;
+
+}
+
+#endif // USPEAK_USPEAKDSPCHAIN_H
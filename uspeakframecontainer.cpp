@@ -7,7 +7,7 @@
 
 #include <limits>
 
-constexpr std::size_t USPEAKFRAME_HEADERSIZE = sizeof(std::uint16_t) + sizeof(std::uint16_t);
+using USpeakNative::USPEAKFRAME_HEADERSIZE;
 
 constexpr bool IsInvalidOpusDataSize(std::size_t size) {
     return size > UINT16_MAX || size <= 0;
@@ -32,7 +32,8 @@ inline std::size_t GetUSpeakFrameSize(std::span<const std::byte> frameData) {
 
     return frameSize;
 }
-inline std::size_t WriteContainerImpl(std::vector<std::byte>& frameData, std::size_t frameDataOffset, std::span<const std::byte> opusData, std::uint16_t frameIndex) {
+template <typename ByteVector>
+inline std::size_t WriteContainerImpl(ByteVector& frameData, std::size_t frameDataOffset, std::span<const std::byte> opusData, std::uint16_t frameIndex) {
     if (IsInvalidOpusDataSize(opusData.size())) {
         fmt::print("[USpeakNative] Opus data size invalid!\n");
         return 0;
@@ -50,12 +51,15 @@ inline std::size_t WriteContainerImpl(std::vector<std::byte>& frameData, std::si
 
     return frameSize;
 }
-inline std::size_t ReadContainerImpl(std::vector<std::byte>& opusData, std::uint16_t& frameIndex, std::span<const std::byte> frameData) {
+template <typename ByteVector>
+inline std::size_t ReadContainerImpl(ByteVector& opusData, std::uint16_t& frameIndex, std::span<const std::byte> frameData) {
     std::size_t frameSize = GetUSpeakFrameSize(frameData);
     if (frameSize == 0) return 0;
 
     std::size_t opusDataSize = frameSize - USPEAKFRAME_HEADERSIZE;
 
+    frameIndex = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(frameData.data(), 0);
+
     auto opusDataView = frameData.subspan(USPEAKFRAME_HEADERSIZE, opusDataSize);
 
     // Read frame
@@ -64,21 +68,41 @@ inline std::size_t ReadContainerImpl(std::vector<std::byte>& opusData, std::uint
     return frameSize;
 }
 
+std::size_t USpeakNative::USpeakFrameContainer::ContainerSize(std::span<const std::byte> frameData)
+{
+    return GetUSpeakFrameSize(frameData);
+}
+
 std::size_t USpeakNative::USpeakFrameContainer::WriteContainer(std::vector<std::byte>& frameData, std::size_t frameDataOffset, std::span<const std::byte> opusData, std::uint16_t frameIndex)
 {
     return WriteContainerImpl(frameData, frameDataOffset, opusData, frameIndex);
 }
 
+std::size_t USpeakNative::USpeakFrameContainer::WriteContainer(std::pmr::vector<std::byte>& frameData, std::size_t frameDataOffset, std::span<const std::byte> opusData, std::uint16_t frameIndex)
+{
+    return WriteContainerImpl(frameData, frameDataOffset, opusData, frameIndex);
+}
+
 std::size_t USpeakNative::USpeakFrameContainer::ReadContainer(std::vector<std::byte>& opusData, std::uint16_t& frameIndex, std::span<const std::byte> frametData)
 {
     return ReadContainerImpl(opusData, frameIndex, frametData);
 }
 
+std::size_t USpeakNative::USpeakFrameContainer::ReadContainer(std::pmr::vector<std::byte>& opusData, std::uint16_t& frameIndex, std::span<const std::byte> frametData)
+{
+    return ReadContainerImpl(opusData, frameIndex, frametData);
+}
+
 USpeakNative::USpeakFrameContainer::USpeakFrameContainer()
     : m_data()
 {
 }
 
+USpeakNative::USpeakFrameContainer::USpeakFrameContainer(std::pmr::memory_resource* resource)
+    : m_data(resource)
+{
+}
+
 std::size_t USpeakNative::USpeakFrameContainer::fromData(std::span<const std::byte> opusData, std::uint16_t frameIndex)
 {
     return WriteContainerImpl(m_data, 0, opusData, frameIndex);
@@ -4,15 +4,22 @@
 #include <span>
 #include <vector>
 #include <cstdint>
+#include <memory_resource>
 
 namespace USpeakNative {
 
+constexpr std::size_t USPEAKFRAME_HEADERSIZE = sizeof(std::uint16_t) + sizeof(std::uint16_t);
+
 struct USpeakFrameContainer
 {
+    static std::size_t ContainerSize(std::span<const std::byte> frameData);
     static std::size_t WriteContainer(std::vector<std::byte>& frameData, std::size_t frameDataOffset, std::span<const std::byte> opusData, std::uint16_t frameIndex);
+    static std::size_t WriteContainer(std::pmr::vector<std::byte>& frameData, std::size_t frameDataOffset, std::span<const std::byte> opusData, std::uint16_t frameIndex);
     static std::size_t ReadContainer(std::vector<std::byte>& opusData, std::uint16_t& frameIndex, std::span<const std::byte> frameData);
+    static std::size_t ReadContainer(std::pmr::vector<std::byte>& opusData, std::uint16_t& frameIndex, std::span<const std::byte> frameData);
 
     USpeakFrameContainer();
+    explicit USpeakFrameContainer(std::pmr::memory_resource* resource);
 
     std::size_t fromData(std::span<const std::byte> opusData, std::uint16_t frameIndex);
     std::size_t decode(std::span<const std::byte> frameData);
@@ -23,7 +30,7 @@ struct USpeakFrameContainer
     std::uint16_t frameIndex() const noexcept;
     std::uint16_t frameSize() const noexcept;
 private:
-    std::vector<std::byte> m_data;
+    std::pmr::vector<std::byte> m_data;
 };
 
 }
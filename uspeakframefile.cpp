@@ -0,0 +1,104 @@
+#include "uspeakframefile.h"
+
+#include "helpers.h"
+#include "uspeakframecontainer.h"
+#include "internal/mappedfile.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+
+constexpr std::string_view USPEAKFRAMEFILE_MAGIC = std::string_view("USPKFRM\0", 8);
+constexpr std::uint32_t USPEAKFRAMEFILE_VERSION = 1;
+constexpr std::size_t USPEAKFRAMEFILE_HEADERSIZE = 8 + 6 * sizeof(std::uint32_t);
+
+bool USpeakNative::WriteFrameFile(std::string_view filename, const USpeakNative::USpeakFrameStore& frames, const USpeakNative::USpeakFrameFileInfo& info)
+{
+    std::fstream file(std::string(filename), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        fmt::print("[USpeakNative] FrameFile: Failed to open {}!\n", filename);
+        return false;
+    }
+
+    std::uint32_t frameCount = static_cast<std::uint32_t>(frames.size());
+
+    std::array<std::byte, USPEAKFRAMEFILE_HEADERSIZE> header;
+    std::memcpy(header.data(), USPEAKFRAMEFILE_MAGIC.data(), USPEAKFRAMEFILE_MAGIC.size());
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 8, USPEAKFRAMEFILE_VERSION);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 12, info.sampleRate);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 16, info.channels);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 20, info.frameDurationMs);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 24, frameCount);
+    std::memcpy(header.data() + 28, &info.loudness, sizeof(float));
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    std::vector<std::uint32_t> offsets;
+    offsets.reserve(frameCount + 1);
+    std::uint32_t offset = 0;
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        offsets.push_back(offset);
+        offset += static_cast<std::uint32_t>(frames.frame(i).size());
+    }
+    offsets.push_back(offset);
+    file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(std::uint32_t));
+
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        auto frame = frames.frame(i);
+        file.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+    }
+
+    return file.good();
+}
+
+bool USpeakNative::ReadFrameFile(std::string_view filename, USpeakNative::USpeakFrameStore& framesOut, USpeakNative::USpeakFrameFileInfo& infoOut)
+{
+    USpeakNative::Internal::MappedFile file;
+    if (!file.open(filename)) {
+        fmt::print("[USpeakNative] FrameFile: Failed to open {}!\n", filename);
+        return false;
+    }
+
+    auto data = file.data();
+    if (data.size() < USPEAKFRAMEFILE_HEADERSIZE || std::memcmp(data.data(), USPEAKFRAMEFILE_MAGIC.data(), USPEAKFRAMEFILE_MAGIC.size()) != 0) {
+        fmt::print("[USpeakNative] FrameFile: {} is not a frame file!\n", filename);
+        return false;
+    }
+    if (USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), 8) != USPEAKFRAMEFILE_VERSION) {
+        fmt::print("[USpeakNative] FrameFile: Unsupported version!\n");
+        return false;
+    }
+
+    infoOut.sampleRate = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), 12);
+    infoOut.channels = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), 16);
+    infoOut.frameDurationMs = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), 20);
+    infoOut.frameCount = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), 24);
+    std::memcpy(&infoOut.loudness, data.data() + 28, sizeof(float));
+
+    std::size_t indexSize = (static_cast<std::size_t>(infoOut.frameCount) + 1) * sizeof(std::uint32_t);
+    if (data.size() < USPEAKFRAMEFILE_HEADERSIZE + indexSize) {
+        fmt::print("[USpeakNative] FrameFile: Index truncated!\n");
+        return false;
+    }
+
+    auto frameData = data.subspan(USPEAKFRAMEFILE_HEADERSIZE + indexSize);
+    for (std::uint32_t i = 0; i < infoOut.frameCount; i++) {
+        std::uint32_t begin = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), USPEAKFRAMEFILE_HEADERSIZE + i * sizeof(std::uint32_t));
+        std::uint32_t end = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), USPEAKFRAMEFILE_HEADERSIZE + (i + 1) * sizeof(std::uint32_t));
+
+        if (begin >= end || end > frameData.size()) {
+            fmt::print("[USpeakNative] FrameFile: Frame {} out of bounds!\n", i);
+            return false;
+        }
+
+        auto frame = frameData.subspan(begin, end - begin);
+        if (USpeakNative::USpeakFrameContainer::ContainerSize(frame) != frame.size() || !framesOut.push(frame)) {
+            fmt::print("[USpeakNative] FrameFile: Frame {} is malformed!\n", i);
+            return false;
+        }
+    }
+
+    return true;
+}
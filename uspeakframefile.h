@@ -0,0 +1,29 @@
+#ifndef USPEAK_USPEAKFRAMEFILE_H
+#define USPEAK_USPEAKFRAMEFILE_H
+
+#include "uspeakframestore.h"
+
+#include <cstdint>
+#include <string_view>
+
+namespace USpeakNative {
+
+// Pre-encoded frame file layout (little endian):
+//   header:  "USPKFRM\0", u32 version, u32 sampleRate, u32 channels, u32 frameDurationMs, u32 frameCount, f32 loudness
+//   index:   u32 offset per frame plus one end offset, relative to the start of the frame data
+//   frames:  frame containers back to back
+
+struct USpeakFrameFileInfo {
+    std::uint32_t sampleRate;
+    std::uint32_t channels;
+    std::uint32_t frameDurationMs;
+    std::uint32_t frameCount;
+    float loudness;
+};
+
+bool WriteFrameFile(std::string_view filename, const USpeakNative::USpeakFrameStore& frames, const USpeakNative::USpeakFrameFileInfo& info);
+bool ReadFrameFile(std::string_view filename, USpeakNative::USpeakFrameStore& framesOut, USpeakNative::USpeakFrameFileInfo& infoOut);
+
+}
+
+#endif // USPEAK_USPEAKFRAMEFILE_H
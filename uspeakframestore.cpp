@@ -0,0 +1,224 @@
+#include "uspeakframestore.h"
+
+#include "uspeakframecontainer.h"
+
+#include <algorithm>
+
+USpeakNative::USpeakFrameStore::USpeakFrameStore(std::uint32_t frameDurationMs)
+    : m_frameDurationMs(frameDurationMs)
+    , m_data()
+    , m_offsets(1, 0)
+    , m_position(0)
+    , m_loopBegin(0)
+    , m_loopEnd(0)
+    , m_paused(false)
+    , m_capacity(0)
+    , m_policy(USpeakNative::QueuePolicy::Block)
+    , m_highWaterMark(0)
+    , m_droppedFrames(0)
+{
+}
+
+bool USpeakNative::USpeakFrameStore::push(std::span<const std::byte> frameContainer)
+{
+    if (frameContainer.size() <= USPEAKFRAME_HEADERSIZE) {
+        return false;
+    }
+
+    if (m_capacity != 0 && queued() >= m_capacity) {
+        switch (m_policy) {
+        case USpeakNative::QueuePolicy::Block:
+        case USpeakNative::QueuePolicy::DropNewest:
+            m_droppedFrames++;
+            return false;
+        case USpeakNative::QueuePolicy::DropOldest:
+            m_droppedFrames++;
+            m_position++;
+            break;
+        case USpeakNative::QueuePolicy::SkipToLatest:
+            m_droppedFrames += queued();
+            m_position = size();
+            break;
+        }
+
+        // Skipped frames are never played, so a long running drop policy must not keep them around
+        discardPlayed();
+    }
+
+    m_data.insert(m_data.end(), frameContainer.begin(), frameContainer.end());
+    m_offsets.push_back(m_data.size());
+
+    m_highWaterMark = std::max(m_highWaterMark, queued());
+
+    return true;
+}
+
+void USpeakNative::USpeakFrameStore::clear()
+{
+    m_data.clear();
+    m_offsets.assign(1, 0);
+    m_position = 0;
+    m_loopBegin = 0;
+    m_loopEnd = 0;
+}
+
+void USpeakNative::USpeakFrameStore::discardPlayed()
+{
+    // A loop can jump back to played frames, so they have to be kept
+    if (m_position == 0 || looping()) {
+        return;
+    }
+
+    std::size_t dataOffset = m_offsets[m_position];
+    m_data.erase(m_data.begin(), m_data.begin() + dataOffset);
+    m_offsets.erase(m_offsets.begin(), m_offsets.begin() + m_position);
+    for (std::size_t& offset : m_offsets) {
+        offset -= dataOffset;
+    }
+    m_position = 0;
+}
+
+void USpeakNative::USpeakFrameStore::setCapacity(std::size_t frames, QueuePolicy policy) noexcept
+{
+    m_capacity = frames;
+    m_policy = policy;
+}
+
+std::size_t USpeakNative::USpeakFrameStore::capacity() const noexcept
+{
+    return m_capacity;
+}
+
+USpeakNative::QueuePolicy USpeakNative::USpeakFrameStore::policy() const noexcept
+{
+    return m_policy;
+}
+
+std::size_t USpeakNative::USpeakFrameStore::queued() const noexcept
+{
+    return size() - std::min(m_position, size());
+}
+
+std::size_t USpeakNative::USpeakFrameStore::highWaterMark() const noexcept
+{
+    return m_highWaterMark;
+}
+
+std::uint64_t USpeakNative::USpeakFrameStore::droppedFrames() const noexcept
+{
+    return m_droppedFrames;
+}
+
+void USpeakNative::USpeakFrameStore::resetQueueStats() noexcept
+{
+    m_highWaterMark = queued();
+    m_droppedFrames = 0;
+}
+
+std::size_t USpeakNative::USpeakFrameStore::size() const noexcept
+{
+    return m_offsets.size() - 1;
+}
+
+std::span<const std::byte> USpeakNative::USpeakFrameStore::frame(std::size_t index) const noexcept
+{
+    if (index >= size()) return {};
+
+    return std::span<const std::byte>(m_data).subspan(m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+}
+
+std::span<const std::byte> USpeakNative::USpeakFrameStore::current() const noexcept
+{
+    if (m_paused) return {};
+
+    return frame(m_position);
+}
+
+void USpeakNative::USpeakFrameStore::advance() noexcept
+{
+    if (m_position >= size()) return;
+
+    m_position++;
+
+    if (looping() && m_position == m_loopEnd) {
+        m_position = m_loopBegin;
+    }
+}
+
+bool USpeakNative::USpeakFrameStore::seekFrame(std::size_t index) noexcept
+{
+    if (index > size()) return false;
+
+    m_position = index;
+
+    return true;
+}
+
+bool USpeakNative::USpeakFrameStore::seekTime(std::uint32_t timeMs) noexcept
+{
+    return seekFrame(timeMs / m_frameDurationMs);
+}
+
+std::size_t USpeakNative::USpeakFrameStore::position() const noexcept
+{
+    return m_position;
+}
+
+bool USpeakNative::USpeakFrameStore::setLoop(std::size_t firstFrame, std::size_t endFrame) noexcept
+{
+    if (firstFrame >= endFrame || endFrame > size()) return false;
+
+    m_loopBegin = firstFrame;
+    m_loopEnd = endFrame;
+
+    return true;
+}
+
+void USpeakNative::USpeakFrameStore::clearLoop() noexcept
+{
+    m_loopBegin = 0;
+    m_loopEnd = 0;
+}
+
+bool USpeakNative::USpeakFrameStore::looping() const noexcept
+{
+    return m_loopEnd != 0;
+}
+
+void USpeakNative::USpeakFrameStore::pause() noexcept
+{
+    m_paused = true;
+}
+
+void USpeakNative::USpeakFrameStore::resume() noexcept
+{
+    m_paused = false;
+}
+
+bool USpeakNative::USpeakFrameStore::paused() const noexcept
+{
+    return m_paused;
+}
+
+std::uint32_t USpeakNative::USpeakFrameStore::durationMs() const noexcept
+{
+    return static_cast<std::uint32_t>(size()) * m_frameDurationMs;
+}
+
+std::uint32_t USpeakNative::USpeakFrameStore::positionMs() const noexcept
+{
+    return static_cast<std::uint32_t>(m_position) * m_frameDurationMs;
+}
+
+std::uint32_t USpeakNative::USpeakFrameStore::remainingMs() const noexcept
+{
+    // A loop that contains the cursor never runs out
+    if (looping() && m_position < m_loopEnd) return UINT32_MAX;
+
+    return static_cast<std::uint32_t>(size() - m_position) * m_frameDurationMs;
+}
+
+std::uint32_t USpeakNative::USpeakFrameStore::frameDurationMs() const noexcept
+{
+    return m_frameDurationMs;
+}
@@ -0,0 +1,75 @@
+#ifndef USPEAK_USPEAKFRAMESTORE_H
+#define USPEAK_USPEAKFRAMESTORE_H
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace USpeakNative {
+
+// What push does once the frames waiting ahead of the cursor reach capacity
+enum class QueuePolicy {
+    Block,          // Refuse the frame, the producer is expected to wait for space
+    DropOldest,     // Skip the oldest queued frame to make room
+    DropNewest,     // Discard the incoming frame
+    SkipToLatest,   // Skip everything queued, playback resumes at the incoming frame
+};
+
+// Retains encoded frame containers back to back with a play cursor, so a clip can be seeked, looped and replayed without re-encoding
+class USpeakFrameStore
+{
+public:
+    USpeakFrameStore(std::uint32_t frameDurationMs);
+
+    bool push(std::span<const std::byte> frameContainer);
+    void clear();
+    void discardPlayed();
+
+    // A capacity of 0 frames means unbounded
+    void setCapacity(std::size_t frames, USpeakNative::QueuePolicy policy) noexcept;
+    std::size_t capacity() const noexcept;
+    USpeakNative::QueuePolicy policy() const noexcept;
+    std::size_t queued() const noexcept;
+    std::size_t highWaterMark() const noexcept;
+    std::uint64_t droppedFrames() const noexcept;
+    void resetQueueStats() noexcept;
+
+    std::size_t size() const noexcept;
+    std::span<const std::byte> frame(std::size_t index) const noexcept;
+
+    std::span<const std::byte> current() const noexcept;
+    void advance() noexcept;
+
+    bool seekFrame(std::size_t index) noexcept;
+    bool seekTime(std::uint32_t timeMs) noexcept;
+    std::size_t position() const noexcept;
+
+    bool setLoop(std::size_t firstFrame, std::size_t endFrame) noexcept;
+    void clearLoop() noexcept;
+    bool looping() const noexcept;
+
+    void pause() noexcept;
+    void resume() noexcept;
+    bool paused() const noexcept;
+
+    std::uint32_t durationMs() const noexcept;
+    std::uint32_t positionMs() const noexcept;
+    std::uint32_t remainingMs() const noexcept;
+    std::uint32_t frameDurationMs() const noexcept;
+private:
+    std::uint32_t m_frameDurationMs;
+    std::vector<std::byte> m_data;
+    std::vector<std::size_t> m_offsets;
+    std::size_t m_position;
+    std::size_t m_loopBegin;
+    std::size_t m_loopEnd;
+    bool m_paused;
+    std::size_t m_capacity;
+    USpeakNative::QueuePolicy m_policy;
+    std::size_t m_highWaterMark;
+    std::uint64_t m_droppedFrames;
+};
+
+}
+
+#endif // USPEAK_USPEAKFRAMESTORE_H
@@ -0,0 +1,265 @@
+#include "uspeakingest.h"
+
+#include "uspeakloudness.h"
+#include "uspeakdspchain.h"
+#include "uspeakframecontainer.h"
+#include "uspeaktrace.h"
+
+#include "fmt/core.h"
+#include "libnyquist/Decoders.h"
+
+#include <cmath>
+#include <array>
+#include <vector>
+#include <algorithm>
+
+constexpr int INGEST_SAMPLERATE = 48000;
+constexpr std::size_t INGEST_BLOCKSIZE = 4096;
+
+namespace {
+
+// Runs mono input through a DspChain of its own (resampling to the codec rate plus any stages the setup adds),
+// loudness normalizes it and encodes every 20ms frame as soon as it is complete.
+// Input can come in blocks of any size, so a file never has to be held in memory as a whole.
+class IngestEncoder
+{
+public:
+    static constexpr std::size_t FrameSize = USpeakNative::OpusCodec::USpeakOpusCodec::FrameSize;
+
+    IngestEncoder(int sampleRate, std::size_t inputFrames, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, float loudness, const USpeakNative::EncodeProgress& progress, const USpeakNative::DspChainSetup& chainSetup)
+        : m_codec(codec)
+        , m_framesOut(framesOut)
+        , m_progress(progress)
+        , m_chain(sampleRate, INGEST_SAMPLERATE, static_cast<std::uint32_t>(USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms))
+        , m_normalizer(INGEST_SAMPLERATE)
+        , m_block()
+        , m_blockFill(0)
+        , m_frame()
+        , m_frameFill(0)
+        , m_skip(m_normalizer.latency())
+        , m_samplesIn(0)
+        , m_frameIndex(0)
+        , m_framesEncoded(0)
+        , m_totalFrames((static_cast<std::size_t>(static_cast<double>(inputFrames) * INGEST_SAMPLERATE / sampleRate) + FrameSize - 1) / FrameSize)
+        , m_cancelled(false)
+    {
+        if (chainSetup) {
+            chainSetup(m_chain);
+        }
+        if (std::isfinite(loudness)) {
+            fmt::print("[USpeakNative] Using known loudness: {} LUFS\n", loudness);
+            m_normalizer.setMeasuredLoudness(loudness);
+        }
+    }
+
+    bool push(std::span<const float> samples) {
+        m_chain.process(samples, [this](std::span<const float> block) { pushBlock(block); });
+        return !m_cancelled;
+    }
+
+    // Pads the last frame with silence and flushes the limiter's lookahead
+    bool finish() {
+        // Chain blocks are one frame long, so the padded block ends on the frame boundary
+        m_chain.flush([this](std::span<const float> block) { pushBlock(block); });
+
+        std::size_t frames = (m_samplesIn + FrameSize - 1) / FrameSize;
+        std::size_t padding = frames * FrameSize - m_samplesIn + m_normalizer.latency();
+        for (std::size_t i = 0; i < padding && !m_cancelled; i++) {
+            pushSample(0.f);
+        }
+        if (m_blockFill > 0) {
+            normalizeBlock();
+        }
+        return !m_cancelled;
+    }
+
+    const USpeakNative::LoudnessMeter& meter() const noexcept {
+        return m_normalizer.meter();
+    }
+private:
+    void pushBlock(std::span<const float> block) {
+        for (float sample : block) {
+            pushSample(sample);
+        }
+    }
+
+    void pushSample(float sample) {
+        m_block[m_blockFill++] = sample;
+        m_samplesIn++;
+        if (m_blockFill == m_block.size()) {
+            normalizeBlock();
+        }
+    }
+
+    void normalizeBlock() {
+        std::span<float> block(m_block.data(), m_blockFill);
+        m_normalizer.process(block);
+        m_blockFill = 0;
+
+        // The limiter delays its output, skip the silence it emits before the first real sample
+        for (float sample : block) {
+            if (m_skip > 0) {
+                m_skip--;
+                continue;
+            }
+
+            m_frame[m_frameFill++] = sample;
+            if (m_frameFill == m_frame.size()) {
+                encodeFrame();
+                m_frameFill = 0;
+            }
+        }
+    }
+
+    void encodeFrame() {
+        if (m_cancelled) {
+            return;
+        }
+
+        USpeakNative::Trace::ScopedEvent encodeEvent("encodeFloat", -1, m_frameIndex);
+
+        USpeakNative::USpeakFrameContainer container;
+        if (container.fromData(m_codec.encodeFloat(m_frame), m_frameIndex++)) {
+            m_framesOut.push(container.encodedData());
+        }
+
+        m_framesEncoded++;
+        if (m_progress && !m_progress(m_framesEncoded, std::max(m_totalFrames, m_framesEncoded))) {
+            m_cancelled = true;
+        }
+    }
+
+    USpeakNative::OpusCodec::USpeakOpusCodec& m_codec;
+    USpeakNative::USpeakFrameStore& m_framesOut;
+    const USpeakNative::EncodeProgress& m_progress;
+    USpeakNative::DspChain m_chain;
+    USpeakNative::LoudnessNormalizer m_normalizer;
+    std::array<float, FrameSize> m_block;
+    std::size_t m_blockFill;
+    std::array<float, FrameSize> m_frame;
+    std::size_t m_frameFill;
+    std::size_t m_skip;
+    std::size_t m_samplesIn;
+    std::uint16_t m_frameIndex;
+    std::size_t m_framesEncoded;
+    std::size_t m_totalFrames;
+    bool m_cancelled;
+};
+
+}
+
+static bool EncodeMapped(USpeakNative::PcmFileReader& reader, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, float& loudness, const USpeakNative::EncodeProgress& progress, const USpeakNative::DspChainSetup& chainSetup)
+{
+    const USpeakNative::PcmFormat& format = reader.format();
+    IngestEncoder encoder(format.sampleRate, reader.frameCount(), codec, framesOut, loudness, progress, chainSetup);
+
+    // Convert straight out of the mapping, only one block of float samples ever exists
+    fmt::print("[USpeakNative] Encoding...\n");
+    std::array<float, INGEST_BLOCKSIZE> block;
+    for (;;) {
+        std::size_t count = reader.readMono(block);
+        if (count == 0) {
+            break;
+        }
+        if (!encoder.push(std::span<const float>(block.data(), count))) {
+            fmt::print("[USpeakNative] Encoding cancelled!\n");
+            return false;
+        }
+    }
+
+    if (!encoder.finish()) {
+        fmt::print("[USpeakNative] Encoding cancelled!\n");
+        return false;
+    }
+
+    if (!std::isfinite(loudness) && encoder.meter().hasMeasurement()) {
+        loudness = encoder.meter().integratedLoudness();
+    }
+
+    return true;
+}
+
+bool USpeakNative::EncodeFile(std::string_view filename, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, float& loudness, const USpeakNative::EncodeProgress& progress, const USpeakNative::DspChainSetup& chainSetup)
+{
+    USpeakNative::Trace::ScopedEvent traceEvent("EncodeFile");
+
+    // Plain WAV skips the full decode, everything else goes through libnyquist
+    {
+        USpeakNative::PcmFileReader reader;
+        if (reader.openWav(filename)) {
+            return EncodeMapped(reader, codec, framesOut, loudness, progress, chainSetup);
+        }
+    }
+
+    try {
+        nqr::NyquistIO loader;
+        nqr::AudioData fileData;
+
+        {
+            USpeakNative::Trace::ScopedEvent loadEvent("LoadFile");
+            loader.Load(&fileData, std::string(filename));
+        }
+
+        if (fileData.sampleRate <= 0) {
+            fmt::print("[USpeakNative] Invalid samplerate: {}\n", fileData.sampleRate);
+            return false;
+        }
+
+        if (fileData.channelCount == 0 || fileData.channelCount > 2) {
+            fmt::print("[USpeakNative] Invalid channelcount: {}\n", fileData.channelCount);
+            return false;
+        }
+
+        std::vector<float> swapBuffer;
+        swapBuffer.reserve(fileData.samples.size());
+
+        // Convert to mono
+        if (fileData.channelCount == 2) {
+            fmt::print("[USpeakNative] Converting to mono...\n");
+            swapBuffer.resize(fileData.samples.size() / 2);
+
+            nqr::StereoToMono(fileData.samples.data(), swapBuffer.data(), fileData.samples.size());
+
+            std::swap(fileData.samples, swapBuffer);
+            fileData.channelCount = 1;
+        }
+
+        IngestEncoder encoder(fileData.sampleRate, fileData.samples.size(), codec, framesOut, loudness, progress, chainSetup);
+
+        fmt::print("[USpeakNative] Encoding...\n");
+        if (!encoder.push(fileData.samples) || !encoder.finish()) {
+            fmt::print("[USpeakNative] Encoding cancelled!\n");
+            return false;
+        }
+
+        if (!std::isfinite(loudness) && encoder.meter().hasMeasurement()) {
+            loudness = encoder.meter().integratedLoudness();
+        }
+    } catch (const std::exception& ex) {
+        fmt::print("[USpeakNative] Failed to read file: {}\n", ex.what());
+        return false;
+    } catch (const std::string& ex) {
+        fmt::print("[USpeakNative] Failed to read file: {}\n", ex);
+        return false;
+    } catch (const char* ex) {
+        fmt::print("[USpeakNative] Failed to read file: {}\n", ex);
+        return false;
+    } catch (...) {
+        fmt::print("[USpeakNative] Failed to read file: Unknown error\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool USpeakNative::EncodePcmFile(std::string_view filename, const USpeakNative::PcmFormat& format, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, float& loudness, const USpeakNative::EncodeProgress& progress, const USpeakNative::DspChainSetup& chainSetup)
+{
+    USpeakNative::Trace::ScopedEvent traceEvent("EncodePcmFile");
+
+    USpeakNative::PcmFileReader reader;
+    if (!reader.openRaw(filename, format)) {
+        return false;
+    }
+
+    return EncodeMapped(reader, codec, framesOut, loudness, progress, chainSetup);
+}
@@ -0,0 +1,27 @@
+#ifndef USPEAK_USPEAKINGEST_H
+#define USPEAK_USPEAKINGEST_H
+
+#include "uspeakframestore.h"
+#include "uspeakpcmfile.h"
+#include "uspeakdspchain.h"
+#include "opuscodec/staticopuscodec.h"
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+namespace USpeakNative {
+
+// Called after every encoded frame, return false to cancel the encode
+using EncodeProgress = std::function<bool(std::size_t framesEncoded, std::size_t totalFrames)>;
+
+// Loads an audio file, downmixes it to mono, loudness normalizes it and encodes it into frame containers.
+// loudness is the integrated loudness of the file in LUFS, pass NaN to have it measured and written back.
+// chainSetup adds stages to the file's own DspChain, they run ahead of the loudness normalizer.
+bool EncodeFile(std::string_view filename, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, float& loudness, const USpeakNative::EncodeProgress& progress = nullptr, const USpeakNative::DspChainSetup& chainSetup = nullptr);
+// Same as EncodeFile for headerless PCM in the given format
+bool EncodePcmFile(std::string_view filename, const USpeakNative::PcmFormat& format, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, float& loudness, const USpeakNative::EncodeProgress& progress = nullptr, const USpeakNative::DspChainSetup& chainSetup = nullptr);
+
+}
+
+#endif // USPEAK_USPEAKINGEST_H
@@ -2,37 +2,72 @@
 
 #include "helpers.h"
 #include "uspeakvolume.h"
+#include "uspeakcapture.h"
+#include "uspeakingest.h"
+#include "uspeakframefile.h"
 #include "uspeakresampler.h"
+#include "uspeakpacketvalidator.h"
+#include "uspeaktrace.h"
 
 #include "fmt/core.h"
-#include "libnyquist/Decoders.h"
-#include "libnyquist/Encoders.h"
 #include "internal/scopedspinlock.h"
+#include "internal/workerpool.h"
 
-constexpr std::size_t USPEAK_HEADERSIZE = sizeof(std::int32_t) + sizeof(std::uint32_t);
-constexpr std::size_t USPEAK_BUFFERSIZE = 1022;
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <filesystem>
 
 USpeakNative::USpeakLite::USpeakLite()
+    : USpeakLite(nullptr)
+{
+}
+
+USpeakNative::USpeakLite::USpeakLite(std::shared_ptr<OpusCodec::OpusStatePool> statePool)
     : m_run(true)
     , m_lock(false)
-    , m_opusCodec(std::make_shared<USpeakNative::OpusCodec::OpusCodec>(48000, 1, USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms))
-    , m_frameQueue()
+    , m_consumed(0)
+    , m_opusCodec(std::make_shared<USpeakNative::OpusCodec::USpeakOpusCodec>(statePool))
+    , m_statePool(std::move(statePool))
+    , m_captureWriter(nullptr)
+    , m_frameStore((std::uint32_t)USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms)
+    , m_overflowFrames((std::uint32_t)USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms)
+    , m_liveInput()
     , m_processingThread(&USpeakNative::USpeakLite::processingLoop, this)
     , m_bandMode(USpeakNative::OpusCodec::BandMode::Opus48k)
-    , m_currentScale(1.f)
-    , m_runningScale(1.f)
-    , m_targetRms(1.f)
+    , m_loudnessCache()
+    , m_fileChain()
+    , m_loads(std::make_shared<PendingLoads>())
+    , m_autoLevelLock(false)
+    , m_autoLevel(1.f)
+    , m_driftEnabled(false)
+    , m_driftLock(false)
+    , m_drift()
+    , m_driftScratch()
 {
     fmt::print("[USpeakNative] Made by OptoCloud\n");
     if (!m_opusCodec->init()) {
-        throw std::exception("Failed to initialize codec!");
+        throw std::runtime_error("Failed to initialize codec!");
     }
+
+    m_opusCodec->state().setByteBudget(USPEAK_PACKETFRAMEBYTES, USPEAK_FRAMESPERPACKET);
     fmt::print("[USpeakNative] Initialized!\n");
 }
 
 USpeakNative::USpeakLite::~USpeakLite()
 {
     m_run.store(false, std::memory_order::relaxed);
+    m_run.notify_all();
+    notifyConsumed();
+
+    // Cancel background loads and wait for them to let go of the instance
+    m_loads->stop.request_stop();
+    {
+        std::unique_lock<std::mutex> l(m_loads->mutex);
+        m_loads->done.wait(l, [this] { return m_loads->count == 0; });
+    }
+
     if (m_processingThread.joinable()) {
         m_processingThread.join();
     }
@@ -47,9 +82,10 @@ USpeakNative::OpusCodec::BandMode USpeakNative::USpeakLite::bandMode() const
 
 std::size_t USpeakNative::USpeakLite::getAudioFrame(std::int32_t playerId, std::uint32_t packetTime, std::span<std::byte> buffer)
 {
+    USpeakNative::Trace::ScopedEvent traceEvent("getAudioFrame", playerId);
     USpeakNative::Internal::ScopedSpinLock l(m_lock);
 
-    if (m_frameQueue.empty() || buffer.size() < 1022) {
+    if (m_frameStore.current().empty() || buffer.size() < USPEAK_BUFFERSIZE) {
         return 0;
     }
 
@@ -58,27 +94,37 @@ std::size_t USpeakNative::USpeakLite::getAudioFrame(std::int32_t playerId, std::
 
     std::size_t sizeWritten = 8;
 
-    for (int i = 0; i < 3; i++) {
-        std::span<const std::byte> frameData = m_frameQueue.front().encodedData();
+    for (std::size_t i = 0; i < USPEAK_FRAMESPERPACKET; i++) {
+        std::span<const std::byte> frameData = m_frameStore.current();
 
-        if (sizeWritten + frameData.size() > buffer.size()) {
+        if (frameData.empty() || sizeWritten + frameData.size() > buffer.size()) {
             break;
         }
 
         memcpy(buffer.data() + sizeWritten, frameData.data(), frameData.size());
         sizeWritten += frameData.size();
 
-        m_frameQueue.pop();
-
-        if (m_frameQueue.empty()) {
-            break;
-        }
+        m_frameStore.advance();
     }
 
+    refillQueue();
+    notifyConsumed();
+
     return sizeWritten;
 }
 
 bool USpeakNative::USpeakLite::encodePacket(const USpeakPacket& packet, std::vector<std::byte>& dataOut)
+{
+    return encodeFrames(packet, dataOut);
+}
+
+bool USpeakNative::USpeakLite::encodePacket(const USpeakPacket& packet, std::pmr::vector<std::byte>& dataOut)
+{
+    return encodeFrames(packet, dataOut);
+}
+
+template <typename ByteVector>
+bool USpeakNative::USpeakLite::encodeFrames(const USpeakPacket& packet, ByteVector& dataOut)
 {
     std::size_t sampleSize = m_opusCodec->sampleSize();
     std::uint16_t frameIndex = 0;
@@ -99,15 +145,14 @@ bool USpeakNative::USpeakLite::encodePacket(const USpeakPacket& packet, std::vec
 
     std::size_t dataOffset = USPEAK_HEADERSIZE;
 
-    USpeakNative::USpeakFrameContainer container;
-
     // Encode
     auto it_a = packet.audioSamples.begin();
     auto it_end = packet.audioSamples.end();
     while (it_a != it_end) {
         auto it_b = it_a + sampleSize;
 
-        dataOffset += USpeakNative::USpeakFrameContainer::WriteContainer(dataOut, dataOffset, m_opusCodec->encodeFloat(std::span<const float>(it_a, it_b), m_bandMode), frameIndex++);
+        USpeakNative::Trace::ScopedEvent traceEvent("encodeFloat", packet.playerId, frameIndex);
+        dataOffset += USpeakNative::USpeakFrameContainer::WriteContainer(dataOut, dataOffset, m_opusCodec->encodeFloat(std::span<const float, USpeakNative::OpusCodec::USpeakOpusCodec::FrameSize>(it_a, it_b)), frameIndex++);
 
         it_a = it_b;
     }
@@ -117,122 +162,650 @@ bool USpeakNative::USpeakLite::encodePacket(const USpeakPacket& packet, std::vec
 
 bool USpeakNative::USpeakLite::decodePacket(std::span<const std::byte> dataIn, USpeakPacket& packetOut)
 {
-    if (dataIn.size() <= USPEAK_HEADERSIZE) {
-        fmt::print("[USpeakNative] Audioframe too small!\n");
+    USpeakNative::Trace::ScopedEvent traceEvent("decodePacket");
+    std::int64_t arrivalUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    if (!decodeFrames(dataIn, packetOut)) {
         return false;
     }
+    traceEvent.setPlayerId(packetOut.playerId);
+
+    {
+        USpeakNative::Trace::ScopedEvent autoLevelEvent("AutoLevel", packetOut.playerId);
+
+        // A non-finite level would stick in the player's gain state and poison every later packet
+        float rms = USpeakNative::GetRMS(packetOut.audioSamples);
+        if (std::isfinite(rms)) {
+            float fromScale, toScale;
+            {
+                USpeakNative::Internal::ScopedSpinLock l(m_autoLevelLock);
+                std::size_t slot = m_autoLevel.slot(packetOut.playerId);
+                m_autoLevel.update(std::span<const std::size_t>(&slot, 1), std::span<const float>(&rms, 1), std::span<float>(&fromScale, 1), std::span<float>(&toScale, 1));
+            }
+            USpeakNative::ApplyGainRamp(packetOut.audioSamples, fromScale, toScale);
+        }
+    }
 
-    // Copy over header
-    packetOut.playerId = USpeakNative::Helpers::ConvertFromBytes<std::int32_t>(dataIn.data(), 0);
-    packetOut.packetTime = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(dataIn.data(), 4);
-    packetOut.audioSamples.clear();
+    compensateDrift(packetOut, arrivalUs);
 
-    // Get all the audio packets, and decode them into float32 samples
-    std::size_t dataOffset = USPEAK_HEADERSIZE;
+    return true;
+}
 
-    std::vector<std::byte> buffer;
+bool USpeakNative::USpeakLite::decodePackets(std::span<const std::span<const std::byte>> dataIn, std::span<USpeakPacket> packetsOut, std::pmr::memory_resource* scratch)
+{
+    if (packetsOut.size() < dataIn.size()) {
+        return false;
+    }
+
+    std::int64_t arrivalUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    std::pmr::vector<std::size_t> decoded(scratch);
+    std::pmr::vector<std::size_t> leveled(scratch);
+    std::pmr::vector<std::size_t> slots(scratch);
+    std::pmr::vector<float> rms(scratch);
+    decoded.reserve(dataIn.size());
+    leveled.reserve(dataIn.size());
+    rms.reserve(dataIn.size());
 
-    // Decode
-    while (dataOffset < dataIn.size()) {
-        std::uint16_t packetIndex;
-        dataOffset += USpeakNative::USpeakFrameContainer::ReadContainer(buffer, packetIndex, dataIn.subspan(dataOffset));
+    for (std::size_t i = 0; i < dataIn.size(); i++) {
+        if (!decodeFrames(dataIn[i], packetsOut[i])) {
+            packetsOut[i].audioSamples.clear();
+            continue;
+        }
+        decoded.push_back(i);
+
+        // A non-finite level would stick in the player's gain state and poison every later packet
+        float level = USpeakNative::GetRMS(packetsOut[i].audioSamples);
+        if (std::isfinite(level)) {
+            leveled.push_back(i);
+            rms.push_back(level);
+        }
+    }
 
-        auto opusData = m_opusCodec->decodeFloat(buffer, m_bandMode);
+    slots.resize(leveled.size());
+    std::pmr::vector<float> fromScale(leveled.size(), scratch);
+    std::pmr::vector<float> toScale(leveled.size(), scratch);
+
+    // Step the gain state of every player in the batch at once, packets from the same player are applied in order
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_autoLevelLock);
+        for (std::size_t i = 0; i < leveled.size(); i++) {
+            slots[i] = m_autoLevel.slot(packetsOut[leveled[i]].playerId);
+        }
+        m_autoLevel.update(slots, rms, fromScale, toScale);
+    }
+
+    for (std::size_t i = 0; i < leveled.size(); i++) {
+        USpeakNative::Trace::ScopedEvent traceEvent("AutoLevel", packetsOut[leveled[i]].playerId);
+        USpeakNative::ApplyGainRamp(packetsOut[leveled[i]].audioSamples, fromScale[i], toScale[i]);
+    }
+    for (std::size_t index : decoded) {
+        compensateDrift(packetsOut[index], arrivalUs);
+    }
+
+    return decoded.size() == dataIn.size();
+}
+
+void USpeakNative::USpeakLite::removePlayer(std::int32_t playerId)
+{
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_autoLevelLock);
+        m_autoLevel.erase(playerId);
+    }
+
+    USpeakNative::Internal::ScopedSpinLock l(m_driftLock);
+    m_drift.erase(playerId);
+}
+
+void USpeakNative::USpeakLite::setDriftCompensation(bool enabled)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_driftLock);
+    m_driftEnabled.store(enabled, std::memory_order::relaxed);
+    m_drift.clear();
+}
+
+double USpeakNative::USpeakLite::playerDriftPpm(std::int32_t playerId)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_driftLock);
+
+    auto it = m_drift.find(playerId);
+    return it == m_drift.end() ? 0. : it->second.driftPpm();
+}
+
+void USpeakNative::USpeakLite::compensateDrift(USpeakPacket& packet, std::int64_t arrivalUs)
+{
+    if (!m_driftEnabled.load(std::memory_order::relaxed)) {
+        return;
+    }
+
+    USpeakNative::Internal::ScopedSpinLock l(m_driftLock);
+
+    DriftCompensator& compensator = m_drift[packet.playerId];
+    compensator.update(packet.packetTime, arrivalUs);
+    compensator.process(packet.audioSamples, m_driftScratch);
+
+    // Copy rather than swap, the packet's samples have to stay on the packet's own memory resource
+    packet.audioSamples.assign(m_driftScratch.begin(), m_driftScratch.end());
+}
+
+bool USpeakNative::USpeakLite::decodeFrames(std::span<const std::byte> dataIn, USpeakPacket& packetOut)
+{
+    // Malformed packets are rejected silently, logging every one would let hostile traffic stall the decode thread anyway
+    USpeakNative::PacketLayout layout;
+    {
+        USpeakNative::Trace::ScopedEvent traceEvent("ValidatePacket");
+        USpeakNative::ValidatePacket(dataIn, layout);
+    }
+
+    // setCaptureWriter can swap the writer from another thread, hold on to the current one while appending
+    if (layout.error != USpeakNative::PacketError::TooSmall) {
+        if (std::shared_ptr<USpeakCaptureWriter> captureWriter = m_captureWriter.load(std::memory_order::acquire)) {
+            captureWriter->append(dataIn);
+        }
+    }
+
+    if (layout.error != USpeakNative::PacketError::None) {
+        return false;
+    }
+
+    // Copy over header
+    packetOut.playerId = layout.playerId;
+    packetOut.packetTime = layout.packetTime;
+    packetOut.audioSamples.clear();
+
+    // Decode straight out of the packet at the offsets found by the validator, the Opus data does not need to be copied out first
+    for (std::size_t i = 0; i < layout.frameCount; i++) {
+        USpeakNative::Trace::ScopedEvent traceEvent("decodeFloat", packetOut.playerId, layout.frameIndex(dataIn, i));
+        auto opusData = m_opusCodec->decodeFloat(layout.opusData(dataIn, i));
 
         if (opusData.size() > 0) {
             packetOut.audioSamples.insert(packetOut.audioSamples.end(), opusData.begin(), opusData.end());
         }
     }
 
-    USpeakNative::AutoLevel(packetOut.audioSamples, USpeakNative::GetRMS(packetOut.audioSamples), m_targetRms, m_currentScale, m_runningScale);
-
-    return true;
+    // A well formed packet can still carry Opus data that doesn't decode
+    return !packetOut.audioSamples.empty();
 }
 
 bool USpeakNative::USpeakLite::streamFile(std::string_view filename)
 {
-    fmt::print("[USpeakNative] Loading: {}\n", filename);
+    return encodeFile(filename, nullptr);
+}
 
-    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+bool USpeakNative::USpeakLite::streamPcmFile(std::string_view filename, const PcmFormat& format)
+{
+    return encodeFile(filename, &format);
+}
 
-    try {
-        nqr::NyquistIO loader;
-        nqr::AudioData fileData;
+bool USpeakNative::USpeakLite::encodeFile(std::string_view filename, const PcmFormat* rawFormat)
+{
+    USpeakNative::Trace::ScopedEvent traceEvent("streamFile");
+    fmt::print("[USpeakNative] Loading: {}\n", filename);
 
-        loader.Load(&fileData, std::string(filename));
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+        // Skip the loudness analysis if this file was measured before. File chain stages change the measured signal, so the cache only holds unprocessed files
+        std::string cacheKey(filename);
+        std::error_code sizeError;
+        std::error_code timeError;
+        auto fileSize = std::filesystem::file_size(cacheKey, sizeError);
+        auto fileTime = std::filesystem::last_write_time(cacheKey, timeError);
+        bool cacheable = !m_fileChain && !sizeError && !timeError;
+
+        float loudness = std::numeric_limits<float>::quiet_NaN();
+        auto cached = m_loudnessCache.find(cacheKey);
+        if (cacheable && cached != m_loudnessCache.end() && cached->second.fileSize == fileSize && cached->second.fileTime == fileTime) {
+            loudness = cached->second.loudness;
+        }
 
-        if (fileData.channelCount == 0 || fileData.channelCount > 2) {
-            fmt::print("[USpeakNative] Invalid channelcount: {}\n", fileData.channelCount);
+        // A full Block queue can't take the clip, encode it into the overflow and let getAudioFrame feed it in
+        USpeakNative::USpeakFrameStore& framesOut = blockingQueue() ? m_overflowFrames : m_frameStore;
+        bool encoded = rawFormat != nullptr
+            ? USpeakNative::EncodePcmFile(filename, *rawFormat, *m_opusCodec, framesOut, loudness, nullptr, m_fileChain)
+            : USpeakNative::EncodeFile(filename, *m_opusCodec, framesOut, loudness, nullptr, m_fileChain);
+        if (!encoded) {
             return false;
         }
 
-        std::vector<float> swapBuffer;
-        swapBuffer.reserve(fileData.samples.size());
+        if (std::isfinite(loudness) && cacheable) {
+            m_loudnessCache[cacheKey] = LoudnessCacheEntry { fileSize, fileTime, loudness };
+        }
+
+        refillQueue();
+    }
 
-        // Convert to mono
-        if (fileData.channelCount == 2) {
-            fmt::print("[USpeakNative] Converting to mono...\n");
-            swapBuffer.resize(fileData.samples.size() / 2);
+    fmt::print("[USpeakNative] Loaded!\n");
 
-            nqr::StereoToMono(fileData.samples.data(), swapBuffer.data(), fileData.samples.size());
+    return true;
+}
 
-            std::swap(fileData.samples, swapBuffer);
-            fileData.channelCount = 1;
-        }
+bool USpeakNative::USpeakLite::streamEncodedFile(std::string_view filename)
+{
+    fmt::print("[USpeakNative] Loading: {}\n", filename);
 
-        std::size_t sampleSize = m_opusCodec->sampleSize();
-        std::uint16_t frameIndex = 0;
+    USpeakNative::USpeakFrameStore frames((std::uint32_t)USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms);
+    USpeakNative::USpeakFrameFileInfo info;
+    if (!USpeakNative::ReadFrameFile(filename, frames, info)) {
+        return false;
+    }
+
+    if (info.sampleRate != 48000 || info.channels != 1 || info.frameDurationMs != (std::uint32_t)USpeakNative::OpusCodec::OpusFrametime::Frametime_20ms) {
+        fmt::print("[USpeakNative] Frame file format mismatch! ({} Hz, {} channels, {} ms)\n", info.sampleRate, info.channels, info.frameDurationMs);
+        return false;
+    }
+
+    enqueueFrames(frames);
+
+    fmt::print("[USpeakNative] Loaded!\n");
+
+    return true;
+}
 
-        // Make sure the number of samples is a multiple of the codec sample size
-        std::size_t nSamples = fileData.samples.size();
-        std::size_t nSamplesFrames = nSamples / sampleSize;
-        std::size_t wholeSampleFrames = nSamplesFrames * sampleSize;
-        if (wholeSampleFrames != nSamples) {
-            fileData.samples.resize(wholeSampleFrames + sampleSize);
+std::future<bool> USpeakNative::USpeakLite::streamFileAsync(std::string_view filename, std::stop_token stopToken, StreamFileCallbacks callbacks)
+{
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+
+    auto job = [this, promise, path = std::string(filename), stopToken, callbacks = std::move(callbacks)]() {
+        bool ok = false;
+        try {
+            ok = loadFile(path, stopToken, callbacks);
+        } catch (...) {
+            fmt::print("[USpeakNative] Failed to load {}: Unknown error\n", path);
         }
+        promise->set_value(ok);
+    };
+
+    // Loads into one instance run one after another, the next is only submitted once the previous has finished
+    bool start;
+    {
+        std::lock_guard<std::mutex> l(m_loads->mutex);
+        m_loads->count++;
+        m_loads->queue.push_back(std::move(job));
+        start = !m_loads->running;
+        m_loads->running = true;
+    }
 
-        // Adjust gain to keep sound between 1 and -1, but dont clip the audio
-        fmt::print("[USpeakNative] Normalizing gain...\n");
-        NormalizeGain(fileData.samples);
+    if (start) {
+        runNextLoad(m_loads);
+    }
 
-        // Encode
-        fmt::print("[USpeakNative] Encoding...\n");
-        auto it_a = fileData.samples.begin();
-        auto it_end = fileData.samples.end();
-        while (it_a != it_end) {
-            auto it_b = it_a + sampleSize;
+    return future;
+}
 
-            USpeakNative::USpeakFrameContainer container;
-            bool ok = container.fromData(m_opusCodec->encodeFloat(std::span<float>(it_a, it_b), m_bandMode), frameIndex++);
+void USpeakNative::USpeakLite::runNextLoad(std::shared_ptr<PendingLoads> loads)
+{
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> l(loads->mutex);
+        if (loads->queue.empty()) {
+            loads->running = false;
+            return;
+        }
+        job = std::move(loads->queue.front());
+        loads->queue.pop_front();
+    }
 
-            if (ok) {
-                m_frameQueue.push(std::move(container));
-            }
+    USpeakNative::Internal::WorkerPool::Shared().submit([loads = std::move(loads), job = std::move(job)]() {
+        job();
 
-            it_a = it_b;
+        // The instance may be gone as soon as the count drops, only the shared state is touched from here on
+        {
+            std::lock_guard<std::mutex> l(loads->mutex);
+            if (--loads->count == 0) {
+                loads->done.notify_all();
+            }
         }
 
-        fmt::print("[USpeakNative] Loaded!\n");
-    } catch (const std::exception& ex) {
-        fmt::print("[USpeakNative] Failed to read file: {}\n", ex.what());
-        return false;
-    } catch (const std::string& ex) {
-        fmt::print("[USpeakNative] Failed to read file: {}\n", ex);
+        runNextLoad(loads);
+    });
+}
+
+bool USpeakNative::USpeakLite::loadFile(const std::string& filename, std::stop_token stopToken, const StreamFileCallbacks& callbacks)
+{
+    USpeakNative::Trace::ScopedEvent traceEvent("streamFileAsync");
+
+    // Either the caller or the destructor can cancel
+    std::stop_source cancel;
+    std::stop_callback callerStop(stopToken, [&cancel] { cancel.request_stop(); });
+    std::stop_callback instanceStop(m_loads->stop.get_token(), [&cancel] { cancel.request_stop(); });
+
+    if (cancel.stop_requested()) {
         return false;
-    } catch (const char* ex) {
-        fmt::print("[USpeakNative] Failed to read file: {}\n", ex);
+    }
+
+    fmt::print("[USpeakNative] Loading: {}\n", filename);
+
+    // A codec of its own keeps the instance's codec free for live input while the file encodes
+    USpeakNative::OpusCodec::USpeakOpusCodec codec(m_statePool);
+    if (!codec.init()) {
         return false;
-    } catch (...) {
-        fmt::print("[USpeakNative] Failed to read file: Unknown error\n");
+    }
+    codec.state().setByteBudget(USPEAK_PACKETFRAMEBYTES, USPEAK_FRAMESPERPACKET);
+
+    std::error_code sizeError;
+    std::error_code timeError;
+    auto fileSize = std::filesystem::file_size(filename, sizeError);
+    auto fileTime = std::filesystem::last_write_time(filename, timeError);
+
+    float loudness = std::numeric_limits<float>::quiet_NaN();
+    USpeakNative::DspChainSetup chainSetup;
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        chainSetup = m_fileChain;
+        auto cached = m_loudnessCache.find(filename);
+        if (!chainSetup && cached != m_loudnessCache.end() && cached->second.fileSize == fileSize && cached->second.fileTime == fileTime) {
+            loudness = cached->second.loudness;
+        }
+    }
+    bool cacheable = !chainSetup && !sizeError && !timeError;
+
+    // Hand every frame over as soon as it is encoded, the staging store only ever holds one
+    USpeakNative::USpeakFrameStore staged(m_frameStore.frameDurationMs());
+    bool ready = false;
+
+    auto progress = [&](std::size_t framesEncoded, std::size_t totalFrames) {
+        enqueueFrames(staged);
+        staged.clear();
+
+        if (!ready && (framesEncoded >= USPEAK_FRAMESPERPACKET || framesEncoded == totalFrames)) {
+            ready = true;
+            if (callbacks.ready) {
+                callbacks.ready();
+            }
+        }
+        if (callbacks.progress) {
+            callbacks.progress(framesEncoded, totalFrames);
+        }
+
+        return !cancel.stop_requested();
+    };
+
+    if (!USpeakNative::EncodeFile(filename, codec, staged, loudness, progress, chainSetup)) {
         return false;
     }
 
+    if (std::isfinite(loudness) && cacheable) {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        m_loudnessCache[filename] = LoudnessCacheEntry { fileSize, fileTime, loudness };
+    }
+
+    fmt::print("[USpeakNative] Loaded!\n");
+
     return true;
 }
 
-void USpeakNative::USpeakLite::processingLoop()
+std::size_t USpeakNative::USpeakLite::pushSamples(std::span<const float> samples, int sampleRate, int channels)
 {
-    while (m_run) {
+    if (sampleRate > 0 && channels > 0) {
+        // Upper bound on the frames this push completes, the resampler and the partial frame can add one
+        std::size_t frameSamples = 48000 / 1000 * m_frameStore.frameDurationMs();
+        std::size_t inputFrames = samples.size() / static_cast<std::size_t>(channels);
+        waitForQueueSpace(inputFrames * 48000 / static_cast<std::size_t>(sampleRate) / frameSamples + 1);
+    }
+
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    // Live input never seeks back, so played frames can go
+    m_frameStore.discardPlayed();
+
+    return m_liveInput.push(samples, sampleRate, channels, *m_opusCodec, m_frameStore);
+}
+
+void USpeakNative::USpeakLite::setInputChain(std::shared_ptr<DspChain> chain)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    m_liveInput.setChain(std::move(chain));
+}
+
+void USpeakNative::USpeakLite::setFileChain(USpeakNative::DspChainSetup setup)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    m_fileChain = std::move(setup);
+}
+
+bool USpeakNative::USpeakLite::setEncoderCpuBudget(std::shared_ptr<OpusCodec::EncoderCpuBudget> budget)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_opusCodec->state().setCpuBudget(std::move(budget));
+}
 
+int USpeakNative::USpeakLite::encoderComplexity()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_opusCodec->state().complexity();
+}
+
+USpeakNative::LiveInputStats USpeakNative::USpeakLite::liveInputStats()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    // End-to-end latency is the encode latency plus the time the frame waits in the queue for getAudioFrame
+    USpeakNative::LiveInputStats stats = m_liveInput.stats();
+    stats.queuedUs = static_cast<std::int64_t>(m_frameStore.remainingMs()) * 1000;
+
+    return stats;
+}
+
+void USpeakNative::USpeakLite::setCaptureWriter(std::shared_ptr<USpeakCaptureWriter> captureWriter)
+{
+    m_captureWriter.store(std::move(captureWriter), std::memory_order::release);
+}
+
+void USpeakNative::USpeakLite::setQueueLimitFrames(std::size_t frames, QueuePolicy policy)
+{
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        m_frameStore.setCapacity(frames, policy);
+        refillQueue();
+    }
+
+    // Blocked producers re-check against the new limit
+    notifyConsumed();
+}
+
+void USpeakNative::USpeakLite::setQueueLimitMs(std::uint32_t ms, QueuePolicy policy)
+{
+    std::uint32_t frameMs = m_frameStore.frameDurationMs();
+    setQueueLimitFrames((ms + frameMs - 1) / frameMs, policy);
+}
+
+USpeakNative::FrameQueueStats USpeakNative::USpeakLite::queueStats()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    std::uint32_t frameMs = m_frameStore.frameDurationMs();
+    std::size_t queued = m_frameStore.queued();
+    std::size_t highWaterMark = m_frameStore.highWaterMark();
+
+    return USpeakNative::FrameQueueStats {
+        queued,
+        static_cast<std::uint32_t>(queued) * frameMs,
+        highWaterMark,
+        static_cast<std::uint32_t>(highWaterMark) * frameMs,
+        m_frameStore.droppedFrames()
+    };
+}
+
+void USpeakNative::USpeakLite::resetQueueStats()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    m_frameStore.resetQueueStats();
+}
+
+bool USpeakNative::USpeakLite::waitForQueueSpace(std::size_t frames)
+{
+    for (;;) {
+        // Sample the counter before checking so a getAudioFrame in between isn't missed
+        std::uint32_t consumed = m_consumed.load(std::memory_order::acquire);
+
+        {
+            USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+            std::size_t capacity = m_frameStore.capacity();
+            std::size_t queued = m_frameStore.queued();
+
+            // Parked file frames go first. An empty queue always takes the push, even one larger than the whole capacity
+            if (!blockingQueue() || (m_overflowFrames.queued() == 0 && (queued == 0 || queued + frames <= capacity))) {
+                return true;
+            }
+        }
+
+        if (!m_run.load(std::memory_order::relaxed)) {
+            return false;
+        }
+
+        m_consumed.wait(consumed, std::memory_order::acquire);
+    }
+}
+
+void USpeakNative::USpeakLite::enqueueFrames(const USpeakFrameStore& frames)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    // Queue what fits and park the rest, producers never wait on playback here
+    bool blocking = blockingQueue();
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        if (blocking && (m_overflowFrames.queued() != 0 || m_frameStore.queued() >= m_frameStore.capacity())) {
+            m_overflowFrames.push(frames.frame(i));
+        } else {
+            m_frameStore.push(frames.frame(i));
+        }
+    }
+}
+
+bool USpeakNative::USpeakLite::blockingQueue() const noexcept
+{
+    return m_frameStore.capacity() != 0 && m_frameStore.policy() == QueuePolicy::Block;
+}
+
+void USpeakNative::USpeakLite::refillQueue()
+{
+    // Called with m_lock held
+    if (m_overflowFrames.queued() == 0) {
+        return;
+    }
+
+    bool blocking = blockingQueue();
+    while (!m_overflowFrames.current().empty() && (!blocking || m_frameStore.queued() < m_frameStore.capacity())) {
+        m_frameStore.push(m_overflowFrames.current());
+        m_overflowFrames.advance();
+    }
+
+    // Both stores only ever stream forward here, drop what is behind them once it outweighs what is ahead
+    if (m_overflowFrames.position() >= m_overflowFrames.queued()) {
+        m_overflowFrames.discardPlayed();
+    }
+    if (blocking && m_frameStore.position() >= m_frameStore.capacity()) {
+        m_frameStore.discardPlayed();
+    }
+}
+
+void USpeakNative::USpeakLite::notifyConsumed()
+{
+    m_consumed.fetch_add(1, std::memory_order::release);
+    m_consumed.notify_all();
+}
+
+bool USpeakNative::USpeakLite::seekFrame(std::size_t frameIndex)
+{
+    bool seeked;
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        seeked = m_frameStore.seekFrame(frameIndex);
+    }
+
+    notifyConsumed();
+
+    return seeked;
+}
+
+bool USpeakNative::USpeakLite::seekTime(std::uint32_t timeMs)
+{
+    bool seeked;
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        seeked = m_frameStore.seekTime(timeMs);
+    }
+
+    notifyConsumed();
+
+    return seeked;
+}
+
+bool USpeakNative::USpeakLite::setLoop(std::size_t firstFrame, std::size_t endFrame)
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_frameStore.setLoop(firstFrame, endFrame);
+}
+
+void USpeakNative::USpeakLite::clearLoop()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    m_frameStore.clearLoop();
+}
+
+void USpeakNative::USpeakLite::pause()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    m_frameStore.pause();
+}
+
+void USpeakNative::USpeakLite::resume()
+{
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        m_frameStore.resume();
+    }
+
+    notifyConsumed();
+}
+
+bool USpeakNative::USpeakLite::paused()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_frameStore.paused();
+}
+
+void USpeakNative::USpeakLite::clearFrames()
+{
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        m_frameStore.clear();
+        m_overflowFrames.clear();
+    }
+
+    notifyConsumed();
+}
+
+std::uint32_t USpeakNative::USpeakLite::durationMs()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_frameStore.durationMs() + m_overflowFrames.remainingMs();
+}
+
+std::uint32_t USpeakNative::USpeakLite::positionMs()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_frameStore.positionMs();
+}
+
+std::uint32_t USpeakNative::USpeakLite::remainingMs()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    std::uint32_t remaining = m_frameStore.remainingMs();
+    if (remaining == UINT32_MAX) {
+        return remaining;
+    }
+    return remaining + m_overflowFrames.remainingMs();
+}
+
+void USpeakNative::USpeakLite::processingLoop()
+{
+    // Nothing to do off-thread yet, block instead of spinning so many instances can share a machine
+    while (m_run.load(std::memory_order::relaxed)) {
+        m_run.wait(true, std::memory_order::relaxed);
     }
 }
@@ -3,46 +3,160 @@
 
 #include "uspeakpacket.h"
 #include "uspeakframecontainer.h"
-#include "opuscodec/opuscodec.h"
+#include "uspeakframestore.h"
+#include "uspeakautoleveltable.h"
+#include "uspeakliveinput.h"
+#include "uspeakdrift.h"
+#include "uspeakpcmfile.h"
+#include "opuscodec/staticopuscodec.h"
 #include "opuscodec/bandmode.h"
 
 #include <span>
-#include <queue>
+#include <deque>
+#include <mutex>
+#include <future>
 #include <memory>
 #include <atomic>
 #include <thread>
+#include <functional>
+#include <stop_token>
+#include <condition_variable>
+#include <string>
+#include <filesystem>
+#include <memory_resource>
+#include <unordered_map>
 #include <cstdint>
 
 namespace USpeakNative {
 
-namespace OpusCodec { class OpusCodec; }
+namespace OpusCodec { class OpusStatePool; class EncoderCpuBudget; }
+class USpeakCaptureWriter;
+
+struct FrameQueueStats {
+    std::size_t queuedFrames;
+    std::uint32_t queuedMs;
+    std::size_t highWaterMarkFrames;
+    std::uint32_t highWaterMarkMs;
+    std::uint64_t droppedFrames;
+};
+
+// Invoked on the loading worker thread
+struct StreamFileCallbacks {
+    std::function<void(std::size_t framesEncoded, std::size_t totalFrames)> progress;
+    std::function<void()> ready; // Once the first packet's worth of frames is queued
+};
 
 class USpeakLite
 {
 public:
     USpeakLite();
+    USpeakLite(std::shared_ptr<OpusCodec::OpusStatePool> statePool);
     ~USpeakLite();
 
     USpeakNative::OpusCodec::BandMode bandMode() const;
     std::size_t getAudioFrame(std::int32_t playerId, std::uint32_t packetTime, std::span<std::byte> buffer);
 
     bool encodePacket(const USpeakNative::USpeakPacket& packet, std::vector<std::byte>& dataOut);
+    bool encodePacket(const USpeakNative::USpeakPacket& packet, std::pmr::vector<std::byte>& dataOut);
     bool decodePacket(std::span<const std::byte> dataIn, USpeakNative::USpeakPacket& packetOut);
+    bool decodePackets(std::span<const std::span<const std::byte>> dataIn, std::span<USpeakNative::USpeakPacket> packetsOut, std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+    void removePlayer(std::int32_t playerId);
+
+    void setDriftCompensation(bool enabled);
+    double playerDriftPpm(std::int32_t playerId);
 
     bool streamFile(std::string_view filename);
+    bool streamPcmFile(std::string_view filename, const USpeakNative::PcmFormat& format);
+    bool streamEncodedFile(std::string_view filename);
+
+    // Loads on the shared worker pool and queues frames as they are encoded, so playback can start before the load finishes.
+    // Loads into the same instance run one after another, loads into different instances run concurrently.
+    std::future<bool> streamFileAsync(std::string_view filename, std::stop_token stopToken = {}, USpeakNative::StreamFileCallbacks callbacks = {});
+
+    std::size_t pushSamples(std::span<const float> samples, int sampleRate, int channels);
+    USpeakNative::LiveInputStats liveInputStats();
+    void setInputChain(std::shared_ptr<DspChain> chain);
+    // Stages for file loads, every load builds a chain of its own from this. Pass nullptr to load files unprocessed
+    void setFileChain(USpeakNative::DspChainSetup setup);
+
+    bool setEncoderCpuBudget(std::shared_ptr<OpusCodec::EncoderCpuBudget> budget);
+    int encoderComplexity();
+
+    void setCaptureWriter(std::shared_ptr<USpeakCaptureWriter> captureWriter);
+
+    // Bounds the frames waiting for getAudioFrame, 0 means unbounded. With QueuePolicy::Block pushSamples waits for getAudioFrame to make room,
+    // file loads return once encoded and park what doesn't fit, getAudioFrame moves it into the queue as space frees up
+    void setQueueLimitFrames(std::size_t frames, USpeakNative::QueuePolicy policy);
+    void setQueueLimitMs(std::uint32_t ms, USpeakNative::QueuePolicy policy);
+    USpeakNative::FrameQueueStats queueStats();
+    void resetQueueStats();
+
+    bool seekFrame(std::size_t frameIndex);
+    bool seekTime(std::uint32_t timeMs);
+    bool setLoop(std::size_t firstFrame, std::size_t endFrame);
+    void clearLoop();
+    void pause();
+    void resume();
+    bool paused();
+    void clearFrames();
+
+    std::uint32_t durationMs();
+    std::uint32_t positionMs();
+    std::uint32_t remainingMs();
 private:
+    struct LoudnessCacheEntry {
+        std::uintmax_t fileSize;
+        std::filesystem::file_time_type fileTime;
+        float loudness;
+    };
+
+    // Shared with the load jobs so the last one can signal the destructor without touching the instance.
+    // Loads wait here rather than on the pool, only the running one ever occupies a worker.
+    struct PendingLoads {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::deque<std::function<void()>> queue;
+        bool running = false;
+        std::size_t count = 0;
+        std::stop_source stop;
+    };
+
+    template <typename ByteVector>
+    bool encodeFrames(const USpeakNative::USpeakPacket& packet, ByteVector& dataOut);
+    bool decodeFrames(std::span<const std::byte> dataIn, USpeakNative::USpeakPacket& packetOut);
+    void compensateDrift(USpeakNative::USpeakPacket& packet, std::int64_t arrivalUs);
+    bool encodeFile(std::string_view filename, const USpeakNative::PcmFormat* rawFormat);
+    static void runNextLoad(std::shared_ptr<PendingLoads> loads);
+    bool loadFile(const std::string& filename, std::stop_token stopToken, const USpeakNative::StreamFileCallbacks& callbacks);
+    bool waitForQueueSpace(std::size_t frames);
+    void enqueueFrames(const USpeakNative::USpeakFrameStore& frames);
+    bool blockingQueue() const noexcept;
+    void refillQueue();
+    void notifyConsumed();
     void processingLoop();
 
     std::atomic_bool m_run;
     std::atomic_bool m_lock;
-    std::shared_ptr<OpusCodec::OpusCodec> m_opusCodec;
-    std::queue<USpeakFrameContainer> m_frameQueue;
+    std::atomic_uint32_t m_consumed;
+    std::shared_ptr<OpusCodec::USpeakOpusCodec> m_opusCodec;
+    std::shared_ptr<OpusCodec::OpusStatePool> m_statePool;
+    std::atomic<std::shared_ptr<USpeakCaptureWriter>> m_captureWriter;
+    USpeakFrameStore m_frameStore;
+    USpeakFrameStore m_overflowFrames; // Loaded frames a full Block queue couldn't take yet, non-empty only under Block
+    USpeakLiveInput m_liveInput;
     std::thread m_processingThread;
     USpeakNative::OpusCodec::BandMode m_bandMode;
+    std::unordered_map<std::string, LoudnessCacheEntry> m_loudnessCache;
+    USpeakNative::DspChainSetup m_fileChain;
+    std::shared_ptr<PendingLoads> m_loads;
+
+    std::atomic_bool m_autoLevelLock;
+    AutoLevelTable m_autoLevel;
 
-    float m_currentScale;
-    float m_runningScale;
-    float m_targetRms;
+    std::atomic_bool m_driftEnabled;
+    std::atomic_bool m_driftLock;
+    std::unordered_map<std::int32_t, DriftCompensator> m_drift;
+    std::vector<float> m_driftScratch;
 };
 
 }
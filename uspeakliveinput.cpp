@@ -0,0 +1,131 @@
+#include "uspeakliveinput.h"
+
+#include "uspeakframecontainer.h"
+#include "uspeaktrace.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+#include <algorithm>
+
+constexpr int LIVEINPUT_SAMPLERATE = 48000;
+constexpr int LIVEINPUT_MAXCHANNELS = 8;
+
+USpeakNative::USpeakLiveInput::USpeakLiveInput()
+    : m_resampler()
+    , m_chain()
+    , m_sampleRate(LIVEINPUT_SAMPLERATE)
+    , m_frame()
+    , m_frameFill(0)
+    , m_container()
+    , m_frameIndex(0)
+    , m_frameStart()
+    , m_framesEncoded(0)
+    , m_lastLatencyUs(0)
+    , m_maxLatencyUs(0)
+    , m_totalLatencyUs(0)
+{
+}
+
+std::size_t USpeakNative::USpeakLiveInput::push(std::span<const float> samples, int sampleRate, int channels, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut)
+{
+    if (sampleRate <= 0 || channels <= 0 || channels > LIVEINPUT_MAXCHANNELS) {
+        fmt::print("[USpeakNative] LiveInput: Invalid format! ({} Hz, {} channels)\n", sampleRate, channels);
+        return 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (sampleRate != m_sampleRate) {
+        m_sampleRate = sampleRate;
+        m_resampler.setRates(sampleRate, LIVEINPUT_SAMPLERATE);
+        m_resampler.reset();
+    }
+
+    // Counted rather than taken from the store's size, a dropping queue policy can shrink the store while frames are pushed
+    std::size_t framesPushed = 0;
+
+    // Downmix interleaved input in small blocks so the resampler can run over a contiguous span
+    std::array<float, 256> mono;
+    std::size_t nFrames = samples.size() / static_cast<std::size_t>(channels);
+    for (std::size_t base = 0; base < nFrames; base += mono.size()) {
+        std::size_t count = std::min(mono.size(), nFrames - base);
+        for (std::size_t i = 0; i < count; i++) {
+            const float* frame = samples.data() + (base + i) * channels;
+            float sum = 0.f;
+            for (int c = 0; c < channels; c++) {
+                sum += frame[c];
+            }
+            mono[i] = sum / static_cast<float>(channels);
+        }
+
+        auto block = std::span<const float>(mono.data(), count);
+        if (m_sampleRate == LIVEINPUT_SAMPLERATE) {
+            for (float sample : block) {
+                framesPushed += pushSample(sample, codec, framesOut, now) ? 1 : 0;
+            }
+        } else {
+            m_resampler.process(block, [&](float sample) { framesPushed += pushSample(sample, codec, framesOut, now) ? 1 : 0; });
+        }
+    }
+
+    return framesPushed;
+}
+
+void USpeakNative::USpeakLiveInput::reset() noexcept
+{
+    m_resampler.reset();
+    m_frameFill = 0;
+    m_frameIndex = 0;
+
+    if (m_chain != nullptr) {
+        m_chain->reset();
+    }
+}
+
+void USpeakNative::USpeakLiveInput::setChain(std::shared_ptr<USpeakNative::DspChain> chain)
+{
+    m_chain = std::move(chain);
+}
+
+USpeakNative::LiveInputStats USpeakNative::USpeakLiveInput::stats() const noexcept
+{
+    return LiveInputStats {
+        m_framesEncoded,
+        m_lastLatencyUs,
+        m_maxLatencyUs,
+        m_framesEncoded == 0 ? 0 : m_totalLatencyUs / static_cast<std::int64_t>(m_framesEncoded),
+        0
+    };
+}
+
+bool USpeakNative::USpeakLiveInput::pushSample(float sample, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, std::chrono::steady_clock::time_point now)
+{
+    if (m_frameFill == 0) {
+        m_frameStart = now;
+    }
+
+    m_frame[m_frameFill++] = sample;
+    if (m_frameFill < m_frame.size()) {
+        return false;
+    }
+    m_frameFill = 0;
+
+    // The frame is exactly one 20ms block, run the stages on it while it is still hot in cache
+    if (m_chain != nullptr) {
+        m_chain->processBlock(m_frame);
+    }
+
+    USpeakNative::Trace::ScopedEvent traceEvent("encodeFloat", -1, m_frameIndex);
+    if (m_container.fromData(codec.encodeFloat(m_frame), m_frameIndex++) == 0 || !framesOut.push(m_container.encodedData())) {
+        return false;
+    }
+
+    std::int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_frameStart).count();
+    m_framesEncoded++;
+    m_lastLatencyUs = latencyUs;
+    m_maxLatencyUs = std::max(m_maxLatencyUs, latencyUs);
+    m_totalLatencyUs += latencyUs;
+
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef USPEAK_USPEAKLIVEINPUT_H
+#define USPEAK_USPEAKLIVEINPUT_H
+
+#include "uspeakresampler.h"
+#include "uspeakframestore.h"
+#include "uspeakframecontainer.h"
+#include "uspeakdspchain.h"
+#include "opuscodec/staticopuscodec.h"
+
+#include <span>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+namespace USpeakNative {
+
+struct LiveInputStats {
+    std::uint64_t framesEncoded;
+    std::int64_t lastLatencyUs;
+    std::int64_t maxLatencyUs;
+    std::int64_t averageLatencyUs;
+    std::int64_t queuedUs;
+};
+
+// Buffers pushed PCM of any rate, channel count and chunk size, and encodes every 20ms frame the moment it is complete.
+// Latency is measured from the arrival of a frame's first sample until its encoded frame is queued.
+class USpeakLiveInput
+{
+public:
+    USpeakLiveInput();
+
+    std::size_t push(std::span<const float> samples, int sampleRate, int channels, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut);
+    void reset() noexcept;
+
+    void setChain(std::shared_ptr<USpeakNative::DspChain> chain);
+
+    LiveInputStats stats() const noexcept;
+private:
+    bool pushSample(float sample, USpeakNative::OpusCodec::USpeakOpusCodec& codec, USpeakNative::USpeakFrameStore& framesOut, std::chrono::steady_clock::time_point now);
+
+    USpeakNative::StreamResampler m_resampler;
+    std::shared_ptr<USpeakNative::DspChain> m_chain;
+    int m_sampleRate;
+    std::array<float, USpeakNative::OpusCodec::USpeakOpusCodec::FrameSize> m_frame;
+    std::size_t m_frameFill;
+    USpeakNative::USpeakFrameContainer m_container;
+    std::uint16_t m_frameIndex;
+    std::chrono::steady_clock::time_point m_frameStart;
+    std::uint64_t m_framesEncoded;
+    std::int64_t m_lastLatencyUs;
+    std::int64_t m_maxLatencyUs;
+    std::int64_t m_totalLatencyUs;
+};
+
+}
+
+#endif // USPEAK_USPEAKLIVEINPUT_H
@@ -0,0 +1,280 @@
+#include "uspeakloudness.h"
+
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <algorithm>
+
+constexpr float LOUDNESS_ABSOLUTEGATE = -70.f;
+constexpr float LOUDNESS_RELATIVEGATE = -10.f;
+constexpr float LOUDNESS_HISTOGRAMMAX = 5.f;
+constexpr float LOUDNESS_HISTOGRAMSTEP = 0.1f;
+constexpr float LOUDNESS_MAXGAINDB = 24.f;
+constexpr float LOUDNESS_GAINTIMECONSTANT = 3.f;
+
+inline float EnergyToLoudness(double energy) {
+    return -0.691f + 10.f * static_cast<float>(std::log10(energy));
+}
+inline double LoudnessToEnergy(float loudness) {
+    return std::pow(10.0, (static_cast<double>(loudness) + 0.691) / 10.0);
+}
+inline float DbToGain(float db) {
+    return std::pow(10.f, db / 20.f);
+}
+
+constexpr std::size_t LOUDNESS_HISTOGRAMBINS = static_cast<std::size_t>((LOUDNESS_HISTOGRAMMAX - LOUDNESS_ABSOLUTEGATE) / LOUDNESS_HISTOGRAMSTEP) + 1;
+
+// Energy at the center of every histogram bin, the same for every meter
+static const std::array<double, LOUDNESS_HISTOGRAMBINS>& BinEnergies()
+{
+    static const std::array<double, LOUDNESS_HISTOGRAMBINS> energies = [] {
+        std::array<double, LOUDNESS_HISTOGRAMBINS> table;
+        for (std::size_t i = 0; i < table.size(); i++) {
+            table[i] = LoudnessToEnergy(LOUDNESS_ABSOLUTEGATE + (static_cast<float>(i) + 0.5f) * LOUDNESS_HISTOGRAMSTEP);
+        }
+        return table;
+    }();
+    return energies;
+}
+
+// Cubic hermite over y[0..3], evaluated between y[1] and y[2]
+inline float Hermite(const std::array<float, 4>& y, float x) {
+    float c1 = 0.5f * (y[2] - y[0]);
+    float c2 = y[0] - 2.5f * y[1] + 2.f * y[2] - 0.5f * y[3];
+    float c3 = 0.5f * (y[3] - y[0]) + 1.5f * (y[1] - y[2]);
+    return ((c3 * x + c2) * x + c1) * x + y[1];
+}
+
+USpeakNative::LoudnessMeter::LoudnessMeter(int sampleRate)
+    : m_shelf()
+    , m_highpass()
+    , m_hopSize(static_cast<std::size_t>(sampleRate / 10))
+    , m_hopFill(0)
+    , m_hopEnergy(0.)
+    , m_hops()
+    , m_hopCount(0)
+    , m_histogram(LOUDNESS_HISTOGRAMBINS, 0)
+    , m_energySum(0.)
+    , m_blockCount(0)
+    , m_integrated(-std::numeric_limits<float>::infinity())
+    , m_integratedValid(true)
+{
+    // K-weighting filter coefficients for an arbitrary sample rate (BS.1770 pre-filter and RLB high-pass)
+    double fs = static_cast<double>(sampleRate);
+
+    double f0 = 1681.974450955533;
+    double G = 3.999843853973347;
+    double Q = 0.7071752369554196;
+    double K = std::tan(std::numbers::pi * f0 / fs);
+    double Vh = std::pow(10.0, G / 20.0);
+    double Vb = std::pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    m_shelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+    m_shelf.b1 = 2.0 * (K * K - Vh) / a0;
+    m_shelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+    m_shelf.a1 = 2.0 * (K * K - 1.0) / a0;
+    m_shelf.a2 = (1.0 - K / Q + K * K) / a0;
+
+    f0 = 38.13547087602444;
+    Q = 0.5003270373238773;
+    K = std::tan(std::numbers::pi * f0 / fs);
+    a0 = 1.0 + K / Q + K * K;
+    m_highpass.b0 = 1.0;
+    m_highpass.b1 = -2.0;
+    m_highpass.b2 = 1.0;
+    m_highpass.a1 = 2.0 * (K * K - 1.0) / a0;
+    m_highpass.a2 = (1.0 - K / Q + K * K) / a0;
+
+    reset();
+}
+
+void USpeakNative::LoudnessMeter::reset() noexcept
+{
+    m_shelf.z1 = m_shelf.z2 = 0.;
+    m_highpass.z1 = m_highpass.z2 = 0.;
+    m_hopFill = 0;
+    m_hopEnergy = 0.;
+    m_hops.fill(0.);
+    m_hopCount = 0;
+    std::fill(m_histogram.begin(), m_histogram.end(), 0);
+    m_energySum = 0.;
+    m_blockCount = 0;
+    m_integrated = -std::numeric_limits<float>::infinity();
+    m_integratedValid = true;
+}
+
+void USpeakNative::LoudnessMeter::process(std::span<const float> samples) noexcept
+{
+    for (float sample : samples) {
+        double weighted = m_highpass.process(m_shelf.process(sample));
+        m_hopEnergy += weighted * weighted;
+
+        if (++m_hopFill == m_hopSize) {
+            // 400ms gating blocks with 75% overlap are built from four 100ms hops
+            m_hops[m_hopCount % m_hops.size()] = m_hopEnergy / static_cast<double>(m_hopSize);
+            m_hopCount++;
+            m_hopFill = 0;
+            m_hopEnergy = 0.;
+
+            if (m_hopCount >= m_hops.size()) {
+                addBlock((m_hops[0] + m_hops[1] + m_hops[2] + m_hops[3]) / 4.0);
+            }
+        }
+    }
+}
+
+bool USpeakNative::LoudnessMeter::hasMeasurement() const noexcept
+{
+    // The relative gate sits below the mean, so the loudest block always passes it
+    return m_blockCount != 0;
+}
+
+float USpeakNative::LoudnessMeter::integratedLoudness() const noexcept
+{
+    if (m_integratedValid) {
+        return m_integrated;
+    }
+    m_integratedValid = true;
+
+    // Blocks below the absolute gate never enter the histogram, the ungated totals are kept up to date by addBlock
+    if (m_blockCount == 0) {
+        m_integrated = -std::numeric_limits<float>::infinity();
+        return m_integrated;
+    }
+
+    float relativeGate = EnergyToLoudness(m_energySum / static_cast<double>(m_blockCount)) + LOUDNESS_RELATIVEGATE;
+    std::size_t firstBin = static_cast<std::size_t>(std::max(0.f, (relativeGate - LOUDNESS_ABSOLUTEGATE) / LOUDNESS_HISTOGRAMSTEP));
+
+    const auto& binEnergies = BinEnergies();
+    double energySum = 0.;
+    std::uint64_t blockCount = 0;
+    for (std::size_t i = firstBin; i < m_histogram.size(); i++) {
+        energySum += binEnergies[i] * m_histogram[i];
+        blockCount += m_histogram[i];
+    }
+
+    m_integrated = blockCount == 0 ? -std::numeric_limits<float>::infinity() : EnergyToLoudness(energySum / static_cast<double>(blockCount));
+    return m_integrated;
+}
+
+float USpeakNative::LoudnessMeter::momentaryLoudness() const noexcept
+{
+    if (m_hopCount < m_hops.size()) {
+        return -std::numeric_limits<float>::infinity();
+    }
+
+    return EnergyToLoudness((m_hops[0] + m_hops[1] + m_hops[2] + m_hops[3]) / 4.0);
+}
+
+void USpeakNative::LoudnessMeter::addBlock(double energy) noexcept
+{
+    float loudness = EnergyToLoudness(energy);
+    if (!(loudness > LOUDNESS_ABSOLUTEGATE)) {
+        return;
+    }
+
+    std::size_t bin = std::min(static_cast<std::size_t>((loudness - LOUDNESS_ABSOLUTEGATE) / LOUDNESS_HISTOGRAMSTEP), m_histogram.size() - 1);
+    m_histogram[bin]++;
+    m_energySum += BinEnergies()[bin];
+    m_blockCount++;
+    m_integratedValid = false;
+}
+
+USpeakNative::LoudnessNormalizer::LoudnessNormalizer(int sampleRate, float targetLufs, float ceilingDb, float lookaheadMs)
+    : m_meter(sampleRate)
+    , m_targetLufs(targetLufs)
+    , m_ceiling(DbToGain(ceilingDb))
+    , m_fixedGain(false)
+    , m_gainDb(0.f)
+    , m_blockSmoothing(1.f / (LOUDNESS_GAINTIMECONSTANT * static_cast<float>(sampleRate)))
+    , m_delay(std::max<std::size_t>(1, static_cast<std::size_t>(lookaheadMs * static_cast<float>(sampleRate) / 1000.f)), 0.f)
+    , m_delayPos(0)
+    , m_history()
+    , m_peakValues(m_delay.size() + 1)
+    , m_peakIndices(m_delay.size() + 1)
+    , m_peakHead(0)
+    , m_peakCount(0)
+    , m_sampleIndex(0)
+    , m_limiterGain(1.f)
+    , m_attack(1.f - std::exp(-4.6f / static_cast<float>(m_delay.size())))
+    , m_release(1.f - std::exp(-1.f / (0.1f * static_cast<float>(sampleRate))))
+{
+    m_history.fill(0.f);
+}
+
+void USpeakNative::LoudnessNormalizer::setMeasuredLoudness(float lufs) noexcept
+{
+    m_fixedGain = std::isfinite(lufs);
+    if (m_fixedGain) {
+        m_gainDb = std::clamp(m_targetLufs - lufs, -LOUDNESS_MAXGAINDB, LOUDNESS_MAXGAINDB);
+    }
+}
+
+void USpeakNative::LoudnessNormalizer::process(std::span<float> samples) noexcept
+{
+    if (samples.empty()) {
+        return;
+    }
+
+    // Without a known loudness, glide towards the gain implied by the loudness measured so far
+    float startGain = DbToGain(m_gainDb);
+    if (!m_fixedGain) {
+        m_meter.process(samples);
+        if (m_meter.hasMeasurement()) {
+            float targetDb = std::clamp(m_targetLufs - m_meter.integratedLoudness(), -LOUDNESS_MAXGAINDB, LOUDNESS_MAXGAINDB);
+            float alpha = std::min(1.f, static_cast<float>(samples.size()) * m_blockSmoothing);
+            m_gainDb += (targetDb - m_gainDb) * alpha;
+        }
+    }
+    float endGain = DbToGain(m_gainDb);
+
+    float gainStep = (endGain - startGain) / static_cast<float>(samples.size());
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        samples[i] = limit(samples[i] * (startGain + gainStep * static_cast<float>(i + 1)));
+    }
+}
+
+std::size_t USpeakNative::LoudnessNormalizer::latency() const noexcept
+{
+    return m_delay.size();
+}
+
+const USpeakNative::LoudnessMeter& USpeakNative::LoudnessNormalizer::meter() const noexcept
+{
+    return m_meter;
+}
+
+float USpeakNative::LoudnessNormalizer::limit(float sample) noexcept
+{
+    // Estimate the inter-sample peak between the two middle history samples
+    m_history = { m_history[1], m_history[2], m_history[3], sample };
+    float peak = std::max({ std::abs(m_history[2]),
+                            std::abs(Hermite(m_history, 0.25f)),
+                            std::abs(Hermite(m_history, 0.5f)),
+                            std::abs(Hermite(m_history, 0.75f)) });
+
+    // Sliding window maximum over the lookahead, kept as a monotonic deque
+    std::size_t capacity = m_peakValues.size();
+    while (m_peakCount > 0 && m_peakValues[(m_peakHead + m_peakCount - 1) % capacity] <= peak) {
+        m_peakCount--;
+    }
+    std::size_t back = (m_peakHead + m_peakCount) % capacity;
+    m_peakValues[back] = peak;
+    m_peakIndices[back] = m_sampleIndex;
+    m_peakCount++;
+    while (m_peakIndices[m_peakHead] + m_delay.size() < m_sampleIndex) {
+        m_peakHead = (m_peakHead + 1) % capacity;
+        m_peakCount--;
+    }
+    m_sampleIndex++;
+
+    float windowPeak = m_peakValues[m_peakHead];
+    float required = windowPeak > m_ceiling ? m_ceiling / windowPeak : 1.f;
+    m_limiterGain += (required - m_limiterGain) * (required < m_limiterGain ? m_attack : m_release);
+
+    float delayed = m_delay[m_delayPos];
+    m_delay[m_delayPos] = sample;
+    m_delayPos = (m_delayPos + 1) % m_delay.size();
+
+    return std::clamp(delayed * m_limiterGain, -m_ceiling, m_ceiling);
+}
@@ -0,0 +1,91 @@
+#ifndef USPEAK_USPEAKLOUDNESS_H
+#define USPEAK_USPEAKLOUDNESS_H
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+namespace USpeakNative {
+
+// ITU-R BS.1770 / EBU R128 loudness meter for mono input, uses constant memory regardless of program length
+class LoudnessMeter
+{
+public:
+    LoudnessMeter(int sampleRate);
+
+    void reset() noexcept;
+    void process(std::span<const float> samples) noexcept;
+
+    bool hasMeasurement() const noexcept;
+    float integratedLoudness() const noexcept;
+    float momentaryLoudness() const noexcept;
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+        double z1, z2;
+
+        double process(double x) noexcept {
+            double y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    void addBlock(double energy) noexcept;
+
+    Biquad m_shelf;
+    Biquad m_highpass;
+    std::size_t m_hopSize;
+    std::size_t m_hopFill;
+    double m_hopEnergy;
+    std::array<double, 4> m_hops;
+    std::size_t m_hopCount;
+    std::vector<std::uint32_t> m_histogram;
+    double m_energySum;
+    std::uint64_t m_blockCount;
+
+    // The gated value only changes when a block lands in the histogram, every 100ms at most
+    mutable float m_integrated;
+    mutable bool m_integratedValid;
+};
+
+// Streaming loudness normalizer with a lookahead true-peak limiter, output is delayed by latency() samples
+class LoudnessNormalizer
+{
+public:
+    LoudnessNormalizer(int sampleRate, float targetLufs = -16.f, float ceilingDb = -1.f, float lookaheadMs = 5.f);
+
+    void setMeasuredLoudness(float lufs) noexcept;
+    void process(std::span<float> samples) noexcept;
+
+    std::size_t latency() const noexcept;
+    // Stops measuring once setMeasuredLoudness() fixed the gain
+    const LoudnessMeter& meter() const noexcept;
+private:
+    float limit(float sample) noexcept;
+
+    LoudnessMeter m_meter;
+    float m_targetLufs;
+    float m_ceiling;
+    bool m_fixedGain;
+    float m_gainDb;
+    float m_blockSmoothing;
+
+    std::vector<float> m_delay;
+    std::size_t m_delayPos;
+    std::array<float, 4> m_history;
+    std::vector<float> m_peakValues;
+    std::vector<std::uint64_t> m_peakIndices;
+    std::size_t m_peakHead;
+    std::size_t m_peakCount;
+    std::uint64_t m_sampleIndex;
+    float m_limiterGain;
+    float m_attack;
+    float m_release;
+};
+
+}
+
+#endif // USPEAK_USPEAKLOUDNESS_H
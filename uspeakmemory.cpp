@@ -0,0 +1,67 @@
+#include "uspeakmemory.h"
+
+USpeakNative::CountingMemoryResource::CountingMemoryResource(std::pmr::memory_resource* upstream) noexcept
+    : m_upstream(upstream)
+    , m_allocations(0)
+    , m_deallocations(0)
+    , m_bytesAllocated(0)
+    , m_bytesInUse(0)
+{
+}
+
+std::uint64_t USpeakNative::CountingMemoryResource::allocations() const noexcept
+{
+    return m_allocations.load(std::memory_order::relaxed);
+}
+
+std::uint64_t USpeakNative::CountingMemoryResource::deallocations() const noexcept
+{
+    return m_deallocations.load(std::memory_order::relaxed);
+}
+
+std::uint64_t USpeakNative::CountingMemoryResource::bytesAllocated() const noexcept
+{
+    return m_bytesAllocated.load(std::memory_order::relaxed);
+}
+
+std::uint64_t USpeakNative::CountingMemoryResource::bytesInUse() const noexcept
+{
+    return m_bytesInUse.load(std::memory_order::relaxed);
+}
+
+void USpeakNative::CountingMemoryResource::resetCounters() noexcept
+{
+    // Bytes in use is not a counter, it still has to match what is outstanding
+    m_allocations.store(0, std::memory_order::relaxed);
+    m_deallocations.store(0, std::memory_order::relaxed);
+    m_bytesAllocated.store(0, std::memory_order::relaxed);
+}
+
+std::pmr::memory_resource* USpeakNative::CountingMemoryResource::upstream() const noexcept
+{
+    return m_upstream;
+}
+
+void* USpeakNative::CountingMemoryResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void* p = m_upstream->allocate(bytes, alignment);
+
+    m_allocations.fetch_add(1, std::memory_order::relaxed);
+    m_bytesAllocated.fetch_add(bytes, std::memory_order::relaxed);
+    m_bytesInUse.fetch_add(bytes, std::memory_order::relaxed);
+
+    return p;
+}
+
+void USpeakNative::CountingMemoryResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    m_upstream->deallocate(p, bytes, alignment);
+
+    m_deallocations.fetch_add(1, std::memory_order::relaxed);
+    m_bytesInUse.fetch_sub(bytes, std::memory_order::relaxed);
+}
+
+bool USpeakNative::CountingMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
@@ -0,0 +1,38 @@
+#ifndef USPEAK_USPEAKMEMORY_H
+#define USPEAK_USPEAKMEMORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+
+namespace USpeakNative {
+
+// Forwards to an upstream resource and counts what passes through, put it under a per-tick arena
+// or hand it straight to packets to check that the steady state path does not allocate
+class CountingMemoryResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingMemoryResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept;
+
+    std::uint64_t allocations() const noexcept;
+    std::uint64_t deallocations() const noexcept;
+    std::uint64_t bytesAllocated() const noexcept;
+    std::uint64_t bytesInUse() const noexcept;
+    void resetCounters() noexcept;
+
+    std::pmr::memory_resource* upstream() const noexcept;
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* m_upstream;
+    std::atomic<std::uint64_t> m_allocations;
+    std::atomic<std::uint64_t> m_deallocations;
+    std::atomic<std::uint64_t> m_bytesAllocated;
+    std::atomic<std::uint64_t> m_bytesInUse;
+};
+
+}
+
+#endif // USPEAK_USPEAKMEMORY_H
@@ -0,0 +1,260 @@
+#include "uspeakoggrecorder.h"
+
+#include "helpers.h"
+#include "uspeakremux.h"
+#include "uspeakpacket.h"
+#include "uspeakframecontainer.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+#include <cstring>
+
+constexpr std::uint32_t OGG_SAMPLERATE = 48000;
+constexpr std::size_t OGG_MAXSEGMENTS = 255;
+constexpr std::int32_t OGG_MAXGAPMS = 6 * 60 * 60 * 1000; // Longer than any pause, the sender's clock jumped
+constexpr std::uint32_t OGG_FILLPACKETSAMPLES = 2880;        // 60ms of empty frames per filler packet
+constexpr std::size_t OGG_TARGETPAGESIZE = 4096;
+constexpr std::uint8_t OGG_HEADERTYPE_NONE = 0x00;
+constexpr std::uint8_t OGG_HEADERTYPE_BOS = 0x02;
+constexpr std::uint8_t OGG_HEADERTYPE_EOS = 0x04;
+
+constexpr std::array<std::uint32_t, 256> MakeOggCrcTable() {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; i++) {
+        std::uint32_t r = i << 24;
+        for (int j = 0; j < 8; j++) {
+            r = (r & 0x80000000u) ? (r << 1) ^ 0x04C11DB7u : (r << 1);
+        }
+        table[i] = r;
+    }
+    return table;
+}
+constexpr std::array<std::uint32_t, 256> OGG_CRCTABLE = MakeOggCrcTable();
+
+inline std::uint32_t OggCrc(std::uint32_t crc, std::span<const std::byte> data) {
+    for (std::byte b : data) {
+        crc = (crc << 8) ^ OGG_CRCTABLE[((crc >> 24) & 0xFF) ^ static_cast<std::uint8_t>(b)];
+    }
+    return crc;
+}
+
+// Number of 48kHz samples in a single Opus frame, taken from the TOC byte (RFC 6716 section 3.1)
+constexpr std::uint32_t OpusTocFrameSamples(std::uint8_t toc) {
+    std::uint8_t config = toc >> 3;
+    if (config < 12) {
+        constexpr std::uint32_t silk[] = { 480, 960, 1920, 2880 };
+        return silk[config & 3];
+    }
+    if (config < 16) {
+        return (config & 1) ? 960 : 480;
+    }
+    constexpr std::uint32_t celt[] = { 120, 240, 480, 960 };
+    return celt[config & 3];
+}
+inline std::uint32_t OpusPacketSamples(std::span<const std::byte> opusData) {
+    if (opusData.empty()) return 0;
+
+    std::uint8_t toc = static_cast<std::uint8_t>(opusData[0]);
+    std::uint32_t frames;
+    switch (toc & 3) {
+    case 0:
+        frames = 1;
+        break;
+    case 1:
+    case 2:
+        frames = 2;
+        break;
+    default:
+        frames = opusData.size() < 2 ? 0 : static_cast<std::uint32_t>(opusData[1]) & 0x3F;
+        break;
+    }
+
+    return frames * OpusTocFrameSamples(toc);
+}
+
+USpeakNative::USpeakOggRecorder::USpeakOggRecorder(std::string_view outputPrefix)
+    : m_outputPrefix(outputPrefix)
+    , m_streams()
+{
+}
+
+USpeakNative::USpeakOggRecorder::~USpeakOggRecorder()
+{
+    finish();
+}
+
+bool USpeakNative::USpeakOggRecorder::addPacket(std::span<const std::byte> packet)
+{
+    if (packet.size() <= USPEAK_HEADERSIZE) {
+        fmt::print("[USpeakNative] OggRecorder: Audioframe too small!\n");
+        return false;
+    }
+
+    std::int32_t playerId = USpeakNative::Helpers::ConvertFromBytes<std::int32_t>(packet.data(), 0);
+    std::uint32_t packetTime = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(packet.data(), 4);
+
+    Stream* stream = getStream(playerId);
+    if (stream == nullptr) {
+        return false;
+    }
+
+    if (stream->granulePos == 0 && stream->lastToc == 0) {
+        stream->startTime = packetTime;
+    } else {
+        // Signed differences so late, reordered and wrapped packetTimes can't turn into a huge gap
+        if (static_cast<std::int32_t>(packetTime - stream->lastPacketTime) <= 0) {
+            return false; // Duplicate or older than what is already written
+        }
+
+        std::uint32_t granuleTime = stream->startTime + static_cast<std::uint32_t>(stream->granulePos / (OGG_SAMPLERATE / 1000));
+        std::int32_t gapMs = static_cast<std::int32_t>(packetTime - granuleTime);
+
+        if (gapMs > OGG_MAXGAPMS) {
+            // Filling this would only write hours of silence, resync the timeline so the packet follows straight on
+            stream->startTime += static_cast<std::uint32_t>(gapMs);
+        } else if (gapMs > 0 && stream->lastToc != 0) {
+            // Fill the gap so the granule position keeps following packetTime and players stay in sync.
+            // Frames without data are treated as lost by decoders, which conceal them and fade to silence.
+            std::uint64_t expectedPos = stream->granulePos + static_cast<std::uint64_t>(gapMs) * (OGG_SAMPLERATE / 1000);
+            std::uint8_t toc = stream->lastToc & 0xFC;
+            std::uint32_t frameSamples = OpusTocFrameSamples(toc);
+
+            // Code 3 packet with equally sized empty frames, two bytes for every 60ms of a long gap
+            std::array<std::byte, 2> fillPacket = { static_cast<std::byte>(toc | 3), static_cast<std::byte>(OGG_FILLPACKETSAMPLES / frameSamples) };
+            while (stream->granulePos + OGG_FILLPACKETSAMPLES <= expectedPos) {
+                writePacket(*stream, fillPacket);
+            }
+
+            // TOC-only packets for what is left
+            std::byte plcPacket = static_cast<std::byte>(toc);
+            while (stream->granulePos + frameSamples <= expectedPos) {
+                writePacket(*stream, std::span<const std::byte>(&plcPacket, 1));
+            }
+        }
+    }
+    stream->lastPacketTime = packetTime;
+
+    std::size_t offset = USPEAK_HEADERSIZE;
+    USpeakNative::USpeakFrameRef frame;
+    while (offset < packet.size()) {
+        if (!USpeakNative::NextFrame(packet, offset, frame)) {
+            fmt::print("[USpeakNative] OggRecorder: Malformed frame at offset {}!\n", offset);
+            return false;
+        }
+
+        auto opusData = frame.container.subspan(USPEAKFRAME_HEADERSIZE);
+        stream->lastToc = static_cast<std::uint8_t>(opusData[0]);
+        writePacket(*stream, opusData);
+    }
+
+    return true;
+}
+
+void USpeakNative::USpeakOggRecorder::finish()
+{
+    for (auto& [playerId, stream] : m_streams) {
+        flushPage(*stream, OGG_HEADERTYPE_EOS);
+        stream->file.close();
+    }
+    m_streams.clear();
+}
+
+USpeakNative::USpeakOggRecorder::Stream* USpeakNative::USpeakOggRecorder::getStream(std::int32_t playerId)
+{
+    auto it = m_streams.find(playerId);
+    if (it != m_streams.end()) {
+        return it->second.get();
+    }
+
+    std::string filename = fmt::format("{}{}.opus", m_outputPrefix, playerId);
+
+    auto stream = std::make_unique<Stream>();
+    stream->file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream->file.is_open()) {
+        fmt::print("[USpeakNative] OggRecorder: Failed to open {}!\n", filename);
+        return nullptr;
+    }
+    stream->serial = static_cast<std::uint32_t>(playerId);
+    stream->pageSequence = 0;
+    stream->startTime = 0;
+    stream->lastPacketTime = 0;
+    stream->granulePos = 0;
+    stream->lastToc = 0;
+    stream->segments.reserve(OGG_MAXSEGMENTS);
+    stream->pageData.reserve(OGG_TARGETPAGESIZE + USPEAK_BUFFERSIZE);
+
+    // OpusHead (RFC 7845 section 5.1), pre-skip is left at 0 to keep the audio aligned with packetTime
+    std::array<std::byte, 19> opusHead{};
+    std::memcpy(opusHead.data(), "OpusHead", 8);
+    opusHead[8] = std::byte{ 1 }; // Version
+    opusHead[9] = std::byte{ 1 }; // Channel count
+    USpeakNative::Helpers::ConvertToBytes<std::uint16_t>(opusHead.data(), 10, 0);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(opusHead.data(), 12, OGG_SAMPLERATE);
+    USpeakNative::Helpers::ConvertToBytes<std::int16_t>(opusHead.data(), 16, 0);
+    opusHead[18] = std::byte{ 0 }; // Mapping family
+    stream->pageData.assign(opusHead.begin(), opusHead.end());
+    stream->segments.push_back(static_cast<std::uint8_t>(opusHead.size()));
+    flushPage(*stream, OGG_HEADERTYPE_BOS);
+
+    // OpusTags (RFC 7845 section 5.2)
+    constexpr std::string_view vendor = "USpeakNative";
+    std::array<std::byte, 8 + 4 + vendor.size() + 4> opusTags{};
+    std::memcpy(opusTags.data(), "OpusTags", 8);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(opusTags.data(), 8, static_cast<std::uint32_t>(vendor.size()));
+    std::memcpy(opusTags.data() + 12, vendor.data(), vendor.size());
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(opusTags.data(), 12 + vendor.size(), 0);
+    stream->pageData.assign(opusTags.begin(), opusTags.end());
+    stream->segments.push_back(static_cast<std::uint8_t>(opusTags.size()));
+    flushPage(*stream, OGG_HEADERTYPE_NONE);
+
+    return m_streams.emplace(playerId, std::move(stream)).first->second.get();
+}
+
+void USpeakNative::USpeakOggRecorder::writePacket(Stream& stream, std::span<const std::byte> opusData)
+{
+    std::size_t nSegments = opusData.size() / 255 + 1;
+    if (stream.segments.size() + nSegments > OGG_MAXSEGMENTS) {
+        flushPage(stream, OGG_HEADERTYPE_NONE);
+    }
+
+    for (std::size_t i = 1; i < nSegments; i++) {
+        stream.segments.push_back(255);
+    }
+    stream.segments.push_back(static_cast<std::uint8_t>(opusData.size() % 255));
+    stream.pageData.insert(stream.pageData.end(), opusData.begin(), opusData.end());
+    stream.granulePos += OpusPacketSamples(opusData);
+
+    if (stream.pageData.size() >= OGG_TARGETPAGESIZE) {
+        flushPage(stream, OGG_HEADERTYPE_NONE);
+    }
+}
+
+void USpeakNative::USpeakOggRecorder::flushPage(Stream& stream, std::uint8_t headerType)
+{
+    if (stream.segments.empty() && headerType != OGG_HEADERTYPE_EOS) {
+        return;
+    }
+
+    std::array<std::byte, 27 + OGG_MAXSEGMENTS> header{};
+    std::memcpy(header.data(), "OggS", 4);
+    header[4] = std::byte{ 0 }; // Version
+    header[5] = static_cast<std::byte>(headerType);
+    USpeakNative::Helpers::ConvertToBytes<std::uint64_t>(header.data(), 6, stream.granulePos);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 14, stream.serial);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 18, stream.pageSequence++);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 22, 0);
+    header[26] = static_cast<std::byte>(stream.segments.size());
+    std::memcpy(header.data() + 27, stream.segments.data(), stream.segments.size());
+
+    auto headerSpan = std::span<const std::byte>(header).first(27 + stream.segments.size());
+
+    std::uint32_t crc = OggCrc(OggCrc(0, headerSpan), stream.pageData);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(header.data(), 22, crc);
+
+    stream.file.write(reinterpret_cast<const char*>(headerSpan.data()), headerSpan.size());
+    stream.file.write(reinterpret_cast<const char*>(stream.pageData.data()), stream.pageData.size());
+
+    stream.segments.clear();
+    stream.pageData.clear();
+}
@@ -0,0 +1,48 @@
+#ifndef USPEAK_USPEAKOGGRECORDER_H
+#define USPEAK_USPEAKOGGRECORDER_H
+
+#include <span>
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+namespace USpeakNative {
+
+// Writes the Opus frames of incoming USpeak packets straight into one Ogg Opus file per player, without transcoding
+class USpeakOggRecorder
+{
+public:
+    USpeakOggRecorder(std::string_view outputPrefix);
+    ~USpeakOggRecorder();
+
+    bool addPacket(std::span<const std::byte> packet);
+    void finish();
+private:
+    struct Stream {
+        std::fstream file;
+        std::uint32_t serial;
+        std::uint32_t pageSequence;
+        std::uint32_t startTime;
+        std::uint32_t lastPacketTime;
+        std::uint64_t granulePos;
+        std::uint8_t lastToc;
+        std::vector<std::uint8_t> segments;
+        std::vector<std::byte> pageData;
+    };
+
+    Stream* getStream(std::int32_t playerId);
+    void writePacket(Stream& stream, std::span<const std::byte> opusData);
+    void flushPage(Stream& stream, std::uint8_t headerType);
+
+    std::string m_outputPrefix;
+    std::unordered_map<std::int32_t, std::unique_ptr<Stream>> m_streams;
+};
+
+}
+
+#endif // USPEAK_USPEAKOGGRECORDER_H
@@ -0,0 +1,95 @@
+#include "uspeakoutputring.h"
+
+#include <bit>
+#include <cstring>
+#include <algorithm>
+
+USpeakNative::USpeakOutputRing::USpeakOutputRing(std::size_t capacity, std::size_t startThreshold)
+    : m_buffer(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+    , m_mask(m_buffer.size() - 1)
+    , m_startThreshold(std::min(startThreshold, m_buffer.size()))
+    , m_writePos(0)
+    , m_overflowSamples(0)
+    , m_readPos(0)
+    , m_underruns(0)
+    , m_underrunSamples(0)
+    , m_playing(false)
+{
+}
+
+std::size_t USpeakNative::USpeakOutputRing::write(std::span<const float> samples) noexcept
+{
+    std::uint64_t writePos = m_writePos.load(std::memory_order::relaxed);
+    std::uint64_t readPos = m_readPos.load(std::memory_order::acquire);
+
+    std::size_t space = m_buffer.size() - static_cast<std::size_t>(writePos - readPos);
+    std::size_t count = std::min(space, samples.size());
+    if (count < samples.size()) {
+        m_overflowSamples.fetch_add(samples.size() - count, std::memory_order::relaxed);
+    }
+
+    // Copy in at most two pieces, around the end of the buffer
+    std::size_t start = static_cast<std::size_t>(writePos) & m_mask;
+    std::size_t first = std::min(count, m_buffer.size() - start);
+    std::memcpy(m_buffer.data() + start, samples.data(), first * sizeof(float));
+    std::memcpy(m_buffer.data(), samples.data() + first, (count - first) * sizeof(float));
+
+    m_writePos.store(writePos + count, std::memory_order::release);
+    return count;
+}
+
+void USpeakNative::USpeakOutputRing::read(std::span<float> block) noexcept
+{
+    std::uint64_t readPos = m_readPos.load(std::memory_order::relaxed);
+    std::uint64_t writePos = m_writePos.load(std::memory_order::acquire);
+    std::size_t queued = static_cast<std::size_t>(writePos - readPos);
+
+    if (!m_playing && queued >= std::max<std::size_t>(m_startThreshold, 1)) {
+        m_playing = true;
+    }
+
+    std::size_t count = m_playing ? std::min(queued, block.size()) : 0;
+
+    std::size_t start = static_cast<std::size_t>(readPos) & m_mask;
+    std::size_t first = std::min(count, m_buffer.size() - start);
+    std::memcpy(block.data(), m_buffer.data() + start, first * sizeof(float));
+    std::memcpy(block.data() + first, m_buffer.data(), (count - first) * sizeof(float));
+
+    if (count < block.size()) {
+        std::fill(block.begin() + count, block.end(), 0.f);
+
+        // Running dry while playing is an underrun, waiting for the start threshold is not
+        if (m_playing) {
+            m_underruns.fetch_add(1, std::memory_order::relaxed);
+            m_underrunSamples.fetch_add(block.size() - count, std::memory_order::relaxed);
+            m_playing = false;
+        }
+    }
+
+    m_readPos.store(readPos + count, std::memory_order::release);
+}
+
+std::size_t USpeakNative::USpeakOutputRing::capacity() const noexcept
+{
+    return m_buffer.size();
+}
+
+std::size_t USpeakNative::USpeakOutputRing::available() const noexcept
+{
+    return static_cast<std::size_t>(m_writePos.load(std::memory_order::acquire) - m_readPos.load(std::memory_order::acquire));
+}
+
+std::uint64_t USpeakNative::USpeakOutputRing::underruns() const noexcept
+{
+    return m_underruns.load(std::memory_order::relaxed);
+}
+
+std::uint64_t USpeakNative::USpeakOutputRing::underrunSamples() const noexcept
+{
+    return m_underrunSamples.load(std::memory_order::relaxed);
+}
+
+std::uint64_t USpeakNative::USpeakOutputRing::overflowSamples() const noexcept
+{
+    return m_overflowSamples.load(std::memory_order::relaxed);
+}
@@ -0,0 +1,50 @@
+#ifndef USPEAK_USPEAKOUTPUTRING_H
+#define USPEAK_USPEAKOUTPUTRING_H
+
+#include <span>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+namespace USpeakNative {
+
+// Single producer, single consumer sample ring between decoding and an audio device callback.
+// The producer writes decoded packets of any size, the callback reads blocks of any size and gets silence for whatever is missing.
+// Neither side locks, and nothing allocates after construction.
+class USpeakOutputRing
+{
+public:
+    USpeakOutputRing(std::size_t capacity = 48000, std::size_t startThreshold = 0);
+    USpeakOutputRing(const USpeakOutputRing&) = delete;
+    USpeakOutputRing& operator=(const USpeakOutputRing&) = delete;
+
+    // Producer side, returns how many samples fit, the rest are dropped and counted as overflow
+    std::size_t write(std::span<const float> samples) noexcept;
+
+    // Consumer side, always fills the whole block. Playback waits until startThreshold samples are queued, initially and after every underrun.
+    void read(std::span<float> block) noexcept;
+
+    std::size_t capacity() const noexcept;
+    std::size_t available() const noexcept;
+
+    std::uint64_t underruns() const noexcept;
+    std::uint64_t underrunSamples() const noexcept;
+    std::uint64_t overflowSamples() const noexcept;
+private:
+    std::vector<float> m_buffer;
+    std::size_t m_mask;
+    std::size_t m_startThreshold;
+
+    // Positions only ever grow, each side owns one of them, kept on separate cache lines
+    alignas(64) std::atomic<std::uint64_t> m_writePos;
+    std::atomic<std::uint64_t> m_overflowSamples;
+
+    alignas(64) std::atomic<std::uint64_t> m_readPos;
+    std::atomic<std::uint64_t> m_underruns;
+    std::atomic<std::uint64_t> m_underrunSamples;
+    bool m_playing;
+};
+
+}
+
+#endif // USPEAK_USPEAKOUTPUTRING_H
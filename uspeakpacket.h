@@ -1,15 +1,51 @@
 #ifndef USPEAK_USPEAKPACKET_H
 #define USPEAK_USPEAKPACKET_H
 
+#include "uspeakframecontainer.h"
+
 #include <vector>
 #include <cstdint>
+#include <memory_resource>
+
+constexpr std::size_t USPEAK_HEADERSIZE = sizeof(std::int32_t) + sizeof(std::uint32_t);
+constexpr std::size_t USPEAK_BUFFERSIZE = 1022;
+constexpr std::size_t USPEAK_FRAMESPERPACKET = 3;
+// Opus bytes the frames of one packet can share, so a full packet always fits into USPEAK_BUFFERSIZE
+constexpr std::size_t USPEAK_PACKETFRAMEBYTES = USPEAK_BUFFERSIZE - USPEAK_HEADERSIZE - USPEAK_FRAMESPERPACKET * USpeakNative::USPEAKFRAME_HEADERSIZE;
 
 namespace USpeakNative {
 
+// Allocator aware, so packets placed in a std::pmr container keep their samples on the same memory resource
 struct USpeakPacket {
+    using allocator_type = std::pmr::polymorphic_allocator<float>;
+
+    USpeakPacket() = default;
+    USpeakPacket(const USpeakPacket&) = default;
+    USpeakPacket(USpeakPacket&&) = default;
+    explicit USpeakPacket(const allocator_type& allocator)
+        : playerId(0)
+        , packetTime(0)
+        , audioSamples(allocator)
+    {
+    }
+    USpeakPacket(const USpeakPacket& other, const allocator_type& allocator)
+        : playerId(other.playerId)
+        , packetTime(other.packetTime)
+        , audioSamples(other.audioSamples, allocator)
+    {
+    }
+    USpeakPacket(USpeakPacket&& other, const allocator_type& allocator)
+        : playerId(other.playerId)
+        , packetTime(other.packetTime)
+        , audioSamples(std::move(other.audioSamples), allocator)
+    {
+    }
+    USpeakPacket& operator=(const USpeakPacket&) = default;
+    USpeakPacket& operator=(USpeakPacket&&) = default;
+
     std::int32_t playerId;
     std::uint32_t packetTime;
-    std::vector<float> audioSamples;
+    std::pmr::vector<float> audioSamples;
 };
 
 }
@@ -0,0 +1,204 @@
+#include "uspeakpacketemitter.h"
+
+#include "uspeaklite.h"
+
+#include "internal/precisetimer.h"
+#include "internal/scopedspinlock.h"
+
+#include <algorithm>
+
+USpeakNative::USpeakPacketEmitter::USpeakPacketEmitter(PacketCallback callback, std::uint32_t missThresholdUs)
+    : m_callback(std::move(callback))
+    , m_missThresholdUs(missThresholdUs)
+    , m_run(false)
+    , m_thread()
+    , m_lock(false)
+    , m_nextStreamId(1)
+    , m_tick(0)
+    , m_streams()
+    , m_wheel()
+    , m_due()
+    , m_packet()
+    , m_statsLock(false)
+    , m_packetsEmitted(0)
+    , m_deadlineMisses(0)
+    , m_maxLatenessUs(0)
+    , m_totalLatenessUs(0)
+{
+}
+
+USpeakNative::USpeakPacketEmitter::~USpeakPacketEmitter()
+{
+    stop();
+}
+
+bool USpeakNative::USpeakPacketEmitter::start()
+{
+    if (m_run.exchange(true, std::memory_order::relaxed)) {
+        return false;
+    }
+
+    m_thread = std::thread(&USpeakNative::USpeakPacketEmitter::emitterLoop, this);
+    return true;
+}
+
+void USpeakNative::USpeakPacketEmitter::stop()
+{
+    m_run.store(false, std::memory_order::relaxed);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool USpeakNative::USpeakPacketEmitter::running() const noexcept
+{
+    return m_run.load(std::memory_order::relaxed);
+}
+
+std::uint64_t USpeakNative::USpeakPacketEmitter::addStream(std::shared_ptr<USpeakLite> source, std::int32_t playerId, std::uint32_t intervalMs)
+{
+    if (source == nullptr || intervalMs == 0 || intervalMs % TickMs != 0) {
+        return 0;
+    }
+
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+    std::uint64_t streamId = m_nextStreamId++;
+    std::uint32_t intervalTicks = intervalMs / TickMs;
+    m_streams.emplace(streamId, Stream { std::move(source), playerId, intervalTicks });
+    schedule(streamId, m_tick + intervalTicks);
+
+    return streamId;
+}
+
+bool USpeakNative::USpeakPacketEmitter::removeStream(std::uint64_t streamId)
+{
+    // Its wheel entry stays behind and is dropped when its tick comes up
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_streams.erase(streamId) != 0;
+}
+
+std::size_t USpeakNative::USpeakPacketEmitter::streamCount()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_lock);
+    return m_streams.size();
+}
+
+USpeakNative::PacketEmitterStats USpeakNative::USpeakPacketEmitter::stats()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_statsLock);
+
+    std::int64_t average = m_packetsEmitted == 0 ? 0 : m_totalLatenessUs / static_cast<std::int64_t>(m_packetsEmitted);
+    return PacketEmitterStats { m_packetsEmitted, m_deadlineMisses, m_maxLatenessUs, average };
+}
+
+void USpeakNative::USpeakPacketEmitter::resetStats()
+{
+    USpeakNative::Internal::ScopedSpinLock l(m_statsLock);
+
+    m_packetsEmitted = 0;
+    m_deadlineMisses = 0;
+    m_maxLatenessUs = 0;
+    m_totalLatenessUs = 0;
+}
+
+void USpeakNative::USpeakPacketEmitter::schedule(std::uint64_t streamId, std::uint64_t deadlineTick)
+{
+    m_wheel[deadlineTick % WheelSize].push_back(WheelEntry { streamId, deadlineTick });
+}
+
+void USpeakNative::USpeakPacketEmitter::processTick(std::uint64_t tick, std::chrono::steady_clock::time_point deadline)
+{
+    // Collect the due streams and reschedule them, the packets are pulled and delivered outside the lock
+    // so callbacks are free to add or remove streams
+    m_due.clear();
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+
+        std::vector<WheelEntry>& slot = m_wheel[tick % WheelSize];
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < slot.size(); i++) {
+            WheelEntry entry = slot[i];
+
+            // Entries more than one revolution out stay in the slot
+            if (entry.deadlineTick > tick) {
+                slot[kept++] = entry;
+                continue;
+            }
+
+            auto it = m_streams.find(entry.streamId);
+            if (it == m_streams.end()) {
+                continue;
+            }
+
+            m_due.push_back(DueStream { entry.streamId, it->second.source, it->second.playerId, static_cast<std::uint32_t>(entry.deadlineTick * TickMs) });
+            std::uint64_t nextTick = entry.deadlineTick + it->second.intervalTicks;
+            if (nextTick % WheelSize == tick % WheelSize) {
+                slot[kept++] = WheelEntry { entry.streamId, nextTick };
+            } else {
+                schedule(entry.streamId, nextTick);
+            }
+        }
+        slot.resize(kept);
+
+        m_tick = tick + 1;
+    }
+
+    std::uint64_t emitted = 0;
+    std::uint64_t misses = 0;
+    std::int64_t maxLateness = 0;
+    std::int64_t totalLateness = 0;
+
+    for (DueStream& due : m_due) {
+        std::int64_t latenessUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - deadline).count();
+
+        std::size_t size = due.source->getAudioFrame(due.playerId, due.packetTime, m_packet);
+        if (size <= USPEAK_HEADERSIZE) {
+            continue;
+        }
+
+        m_callback(due.streamId, std::span<const std::byte>(m_packet).first(size));
+
+        emitted++;
+        totalLateness += latenessUs;
+        maxLateness = std::max(maxLateness, latenessUs);
+        if (latenessUs > m_missThresholdUs) {
+            misses++;
+        }
+    }
+
+    // Drop the source references here rather than at the next tick, removed streams should not outlive their removal by a tick
+    m_due.clear();
+
+    if (emitted == 0) {
+        return;
+    }
+
+    USpeakNative::Internal::ScopedSpinLock l(m_statsLock);
+    m_packetsEmitted += emitted;
+    m_deadlineMisses += misses;
+    m_totalLatenessUs += totalLateness;
+    m_maxLatenessUs = std::max(m_maxLatenessUs, maxLateness);
+}
+
+void USpeakNative::USpeakPacketEmitter::emitterLoop()
+{
+    USpeakNative::Internal::PreciseTimer timer;
+
+    std::uint64_t tick;
+    {
+        USpeakNative::Internal::ScopedSpinLock l(m_lock);
+        tick = m_tick;
+    }
+
+    // Deadlines are absolute, a late tick never pushes the ones after it back
+    auto epoch = std::chrono::steady_clock::now() - std::chrono::milliseconds(tick * TickMs);
+
+    while (m_run.load(std::memory_order::relaxed)) {
+        auto deadline = epoch + std::chrono::milliseconds(tick * TickMs);
+        timer.sleepUntil(deadline);
+
+        processTick(tick, deadline);
+        tick++;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef USPEAK_USPEAKPACKETEMITTER_H
+#define USPEAK_USPEAKPACKETEMITTER_H
+
+#include "uspeakpacket.h"
+
+#include <span>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+namespace USpeakNative {
+
+class USpeakLite;
+
+struct PacketEmitterStats {
+    std::uint64_t packetsEmitted;
+    std::uint64_t deadlineMisses;
+    std::int64_t maxLatenessUs;
+    std::int64_t averageLatenessUs;
+};
+
+// Paces outbound packets for any number of USpeakLite streams from a single thread.
+// Streams sit in a timer wheel of 5ms ticks, the thread sleeps until each tick's absolute deadline and pulls a packet from every stream due on it.
+// packetTime is the stream's deadline in milliseconds since the emitter started, so it is monotonic no matter how late a packet goes out.
+class USpeakPacketEmitter
+{
+public:
+    using PacketCallback = std::function<void(std::uint64_t streamId, std::span<const std::byte> packet)>;
+
+    USpeakPacketEmitter(PacketCallback callback, std::uint32_t missThresholdUs = 2000);
+    ~USpeakPacketEmitter();
+
+    bool start();
+    void stop();
+    bool running() const noexcept;
+
+    std::uint64_t addStream(std::shared_ptr<USpeakNative::USpeakLite> source, std::int32_t playerId, std::uint32_t intervalMs = 60);
+    bool removeStream(std::uint64_t streamId);
+    std::size_t streamCount();
+
+    PacketEmitterStats stats();
+    void resetStats();
+private:
+    struct Stream {
+        std::shared_ptr<USpeakNative::USpeakLite> source;
+        std::int32_t playerId;
+        std::uint32_t intervalTicks;
+    };
+    struct WheelEntry {
+        std::uint64_t streamId;
+        std::uint64_t deadlineTick;
+    };
+    struct DueStream {
+        std::uint64_t streamId;
+        std::shared_ptr<USpeakNative::USpeakLite> source;
+        std::int32_t playerId;
+        std::uint32_t packetTime;
+    };
+
+    static constexpr std::uint32_t TickMs = 5;
+    static constexpr std::size_t WheelSize = 64;
+
+    void schedule(std::uint64_t streamId, std::uint64_t deadlineTick);
+    void processTick(std::uint64_t tick, std::chrono::steady_clock::time_point deadline);
+    void emitterLoop();
+
+    PacketCallback m_callback;
+    std::int64_t m_missThresholdUs;
+
+    std::atomic_bool m_run;
+    std::thread m_thread;
+
+    std::atomic_bool m_lock;
+    std::uint64_t m_nextStreamId;
+    std::uint64_t m_tick;
+    std::unordered_map<std::uint64_t, Stream> m_streams;
+    std::array<std::vector<WheelEntry>, WheelSize> m_wheel;
+
+    std::vector<DueStream> m_due;
+    std::array<std::byte, USPEAK_BUFFERSIZE> m_packet;
+
+    std::atomic_bool m_statsLock;
+    std::uint64_t m_packetsEmitted;
+    std::uint64_t m_deadlineMisses;
+    std::int64_t m_maxLatenessUs;
+    std::int64_t m_totalLatenessUs;
+};
+
+}
+
+#endif // USPEAK_USPEAKPACKETEMITTER_H
@@ -0,0 +1,91 @@
+#include "uspeakpacketvalidator.h"
+
+#include "helpers.h"
+
+static bool Fail(USpeakNative::PacketLayout& layout, USpeakNative::PacketError error, std::size_t offset) noexcept
+{
+    layout.error = error;
+    layout.errorOffset = static_cast<std::uint16_t>(offset);
+    return false;
+}
+
+std::uint16_t USpeakNative::PacketLayout::frameIndex(std::span<const std::byte> packet, std::size_t frame) const noexcept
+{
+    return USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(packet.data(), offsets[frame]);
+}
+
+bool USpeakNative::ValidatePacket(std::span<const std::byte> packet, PacketLayout& layoutOut) noexcept
+{
+    layoutOut.error = USpeakNative::PacketError::None;
+    layoutOut.errorOffset = 0;
+    layoutOut.frameCount = 0;
+    layoutOut.indexGaps = 0;
+
+    std::size_t size = packet.size();
+    if (size < USPEAK_HEADERSIZE + USpeakNative::USPEAKFRAME_HEADERSIZE) {
+        return Fail(layoutOut, USpeakNative::PacketError::TooSmall, 0);
+    }
+    if (size > USPEAK_BUFFERSIZE) {
+        return Fail(layoutOut, USpeakNative::PacketError::TooLarge, USPEAK_BUFFERSIZE);
+    }
+
+    layoutOut.playerId = USpeakNative::Helpers::ConvertFromBytes<std::int32_t>(packet.data(), 0);
+    layoutOut.packetTime = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(packet.data(), 4);
+
+    // Every step advances by at least one frame header plus a byte, so the walk is bounded by the packet size
+    std::size_t offset = USPEAK_HEADERSIZE;
+    std::size_t count = 0;
+    std::uint16_t gaps = 0;
+    std::uint16_t expectedIndex = 0;
+    while (offset < size) {
+        std::size_t remaining = size - offset;
+        if (remaining < USpeakNative::USPEAKFRAME_HEADERSIZE) {
+            return Fail(layoutOut, USpeakNative::PacketError::TruncatedFrame, offset);
+        }
+        if (count == USPEAK_MAXFRAMESPERPACKET) {
+            return Fail(layoutOut, USpeakNative::PacketError::TooManyFrames, offset);
+        }
+
+        std::uint16_t frameIndex = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(packet.data(), offset);
+        std::size_t opusSize = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(packet.data(), offset + 2);
+        if (opusSize == 0) {
+            return Fail(layoutOut, USpeakNative::PacketError::EmptyFrame, offset);
+        }
+        if (opusSize > remaining - USpeakNative::USPEAKFRAME_HEADERSIZE) {
+            return Fail(layoutOut, USpeakNative::PacketError::FrameOverrun, offset);
+        }
+
+        gaps += static_cast<std::uint16_t>((count != 0) & (frameIndex != expectedIndex));
+        expectedIndex = static_cast<std::uint16_t>(frameIndex + 1);
+
+        layoutOut.offsets[count++] = static_cast<std::uint16_t>(offset);
+        offset += USpeakNative::USPEAKFRAME_HEADERSIZE + opusSize;
+    }
+
+    layoutOut.offsets[count] = static_cast<std::uint16_t>(offset);
+    layoutOut.frameCount = static_cast<std::uint16_t>(count);
+    layoutOut.indexGaps = gaps;
+
+    return true;
+}
+
+const char* USpeakNative::PacketErrorString(PacketError error) noexcept
+{
+    switch (error) {
+    case USpeakNative::PacketError::None:
+        return "None";
+    case USpeakNative::PacketError::TooSmall:
+        return "Packet too small";
+    case USpeakNative::PacketError::TooLarge:
+        return "Packet too large";
+    case USpeakNative::PacketError::TruncatedFrame:
+        return "Truncated frame header";
+    case USpeakNative::PacketError::EmptyFrame:
+        return "Empty frame";
+    case USpeakNative::PacketError::FrameOverrun:
+        return "Frame overruns packet";
+    case USpeakNative::PacketError::TooManyFrames:
+        return "Too many frames";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,51 @@
+#ifndef USPEAK_USPEAKPACKETVALIDATOR_H
+#define USPEAK_USPEAKPACKETVALIDATOR_H
+
+#include "uspeakpacket.h"
+#include "uspeakframecontainer.h"
+
+#include <span>
+#include <array>
+#include <cstdint>
+
+// Packets are at most USPEAK_BUFFERSIZE bytes, merged packets may carry more than USPEAK_FRAMESPERPACKET frames
+constexpr std::size_t USPEAK_MAXFRAMESPERPACKET = 64;
+
+namespace USpeakNative {
+
+enum class PacketError : std::uint8_t {
+    None,
+    TooSmall,           // No room for the header and a frame
+    TooLarge,           // Larger than USPEAK_BUFFERSIZE
+    TruncatedFrame,     // Fewer bytes left than a frame header
+    EmptyFrame,         // Frame without Opus data
+    FrameOverrun,       // Frame length runs past the end of the packet
+    TooManyFrames,      // More than USPEAK_MAXFRAMESPERPACKET frames
+};
+
+// Where every frame of a packet starts, filled in a single pass by ValidatePacket so decoding never parses the packet again
+struct PacketLayout {
+    std::int32_t playerId;
+    std::uint32_t packetTime;
+    USpeakNative::PacketError error;
+    std::uint16_t errorOffset;
+    std::uint16_t frameCount;
+    std::uint16_t indexGaps; // Frames whose frameIndex doesn't follow the previous frame's, not an error
+    std::array<std::uint16_t, USPEAK_MAXFRAMESPERPACKET + 1> offsets; // Plus the end of the last frame
+
+    std::span<const std::byte> container(std::span<const std::byte> packet, std::size_t frame) const noexcept {
+        return packet.subspan(offsets[frame], offsets[frame + 1] - offsets[frame]);
+    }
+    std::span<const std::byte> opusData(std::span<const std::byte> packet, std::size_t frame) const noexcept {
+        return packet.subspan(offsets[frame] + USpeakNative::USPEAKFRAME_HEADERSIZE, offsets[frame + 1] - offsets[frame] - USpeakNative::USPEAKFRAME_HEADERSIZE);
+    }
+    std::uint16_t frameIndex(std::span<const std::byte> packet, std::size_t frame) const noexcept;
+};
+
+// Checks the header and every frame container without allocating or logging, returns false and sets error and errorOffset on the first fault
+bool ValidatePacket(std::span<const std::byte> packet, USpeakNative::PacketLayout& layoutOut) noexcept;
+const char* PacketErrorString(USpeakNative::PacketError error) noexcept;
+
+}
+
+#endif // USPEAK_USPEAKPACKETVALIDATOR_H
@@ -0,0 +1,271 @@
+#include "uspeakpcmfile.h"
+
+#include "helpers.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+#include <cstring>
+#include <algorithm>
+
+// Consumed sample data is handed back to the OS in blocks of this size
+constexpr std::size_t PCMFILE_DISCARDSIZE = 1 << 20;
+// Extends each discard backwards over the previous one's partial end page, larger than any page size
+constexpr std::size_t PCMFILE_DISCARDOVERLAP = 1 << 16;
+
+constexpr std::uint16_t WAVE_FORMAT_PCM = 0x0001;
+constexpr std::uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+constexpr std::uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+static std::size_t SampleBytes(USpeakNative::PcmEncoding encoding)
+{
+    switch (encoding) {
+    case USpeakNative::PcmEncoding::UInt8:
+        return 1;
+    case USpeakNative::PcmEncoding::Int16:
+        return 2;
+    case USpeakNative::PcmEncoding::Int24:
+        return 3;
+    case USpeakNative::PcmEncoding::Int32:
+    case USpeakNative::PcmEncoding::Float32:
+        return 4;
+    case USpeakNative::PcmEncoding::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+template <typename Convert>
+static void Downmix(const std::byte* src, std::span<float> out, std::size_t channels, std::size_t sampleBytes, Convert convert)
+{
+    float scale = 1.f / static_cast<float>(channels);
+    for (float& sample : out) {
+        float sum = 0.f;
+        for (std::size_t c = 0; c < channels; c++) {
+            sum += convert(src);
+            src += sampleBytes;
+        }
+        sample = sum * scale;
+    }
+}
+
+USpeakNative::PcmFileReader::PcmFileReader()
+    : m_file()
+    , m_samples()
+    , m_format { USpeakNative::PcmEncoding::Int16, 0, 0 }
+    , m_frameBytes(0)
+    , m_position(0)
+    , m_discarded(0)
+{
+}
+
+bool USpeakNative::PcmFileReader::openWav(std::string_view filename)
+{
+    close();
+
+    if (!m_file.open(filename)) {
+        return false;
+    }
+
+    auto data = m_file.data();
+    if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 || std::memcmp(data.data() + 8, "WAVE", 4) != 0) {
+        close();
+        return false;
+    }
+
+    USpeakNative::PcmFormat format { USpeakNative::PcmEncoding::Int16, 0, 0 };
+    bool hasFormat = false;
+
+    std::size_t offset = 12;
+    while (offset + 8 <= data.size()) {
+        const std::byte* chunkId = data.data() + offset;
+        std::size_t chunkSize = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), offset + 4);
+        offset += 8;
+        std::size_t available = data.size() - offset;
+
+        if (std::memcmp(chunkId, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || chunkSize > available) {
+                break;
+            }
+
+            std::uint16_t formatTag = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(data.data(), offset);
+            std::uint16_t channels = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(data.data(), offset + 2);
+            std::uint32_t sampleRate = USpeakNative::Helpers::ConvertFromBytes<std::uint32_t>(data.data(), offset + 4);
+            std::uint16_t blockAlign = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(data.data(), offset + 12);
+            std::uint16_t bitsPerSample = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(data.data(), offset + 14);
+
+            // The extensible SubFormat GUID starts with the plain format tag
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 40) {
+                formatTag = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(data.data(), offset + 24);
+            }
+
+            if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 8) {
+                format.encoding = USpeakNative::PcmEncoding::UInt8;
+            } else if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 16) {
+                format.encoding = USpeakNative::PcmEncoding::Int16;
+            } else if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 24) {
+                format.encoding = USpeakNative::PcmEncoding::Int24;
+            } else if (formatTag == WAVE_FORMAT_PCM && bitsPerSample == 32) {
+                format.encoding = USpeakNative::PcmEncoding::Int32;
+            } else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 32) {
+                format.encoding = USpeakNative::PcmEncoding::Float32;
+            } else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 64) {
+                format.encoding = USpeakNative::PcmEncoding::Float64;
+            } else {
+                break;
+            }
+
+            // Padded containers (24 bits in 32) are left to the full decoder
+            if (blockAlign != channels * SampleBytes(format.encoding)) {
+                break;
+            }
+
+            format.sampleRate = static_cast<int>(sampleRate);
+            format.channels = channels;
+            hasFormat = true;
+        } else if (std::memcmp(chunkId, "data", 4) == 0) {
+            if (!hasFormat) {
+                break;
+            }
+
+            // Streaming writers leave the size at 0 or 0xFFFFFFFF, the data runs to the end of the file then
+            std::size_t dataSize = (chunkSize == 0 || chunkSize > available) ? available : chunkSize;
+            if (setFormat(format, data.subspan(offset, dataSize))) {
+                return true;
+            }
+            break;
+        }
+
+        offset += chunkSize + (chunkSize & 1);
+    }
+
+    close();
+    return false;
+}
+
+bool USpeakNative::PcmFileReader::openRaw(std::string_view filename, const PcmFormat& format)
+{
+    close();
+
+    if (!m_file.open(filename)) {
+        fmt::print("[USpeakNative] PcmFile: Failed to open {}!\n", filename);
+        return false;
+    }
+
+    if (!setFormat(format, m_file.data())) {
+        fmt::print("[USpeakNative] PcmFile: Invalid format! ({} Hz, {} channels)\n", format.sampleRate, format.channels);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void USpeakNative::PcmFileReader::close()
+{
+    m_file.close();
+    m_samples = {};
+    m_frameBytes = 0;
+    m_position = 0;
+    m_discarded = 0;
+}
+
+const USpeakNative::PcmFormat& USpeakNative::PcmFileReader::format() const noexcept
+{
+    return m_format;
+}
+
+std::size_t USpeakNative::PcmFileReader::frameCount() const noexcept
+{
+    return m_frameBytes == 0 ? 0 : m_samples.size() / m_frameBytes;
+}
+
+std::size_t USpeakNative::PcmFileReader::remainingFrames() const noexcept
+{
+    return frameCount() - m_position;
+}
+
+std::size_t USpeakNative::PcmFileReader::readMono(std::span<float> out) noexcept
+{
+    std::size_t frames = std::min(out.size(), remainingFrames());
+    if (frames == 0) {
+        return 0;
+    }
+
+    out = out.first(frames);
+    const std::byte* src = m_samples.data() + m_position * m_frameBytes;
+    std::size_t channels = static_cast<std::size_t>(m_format.channels);
+    std::size_t sampleBytes = SampleBytes(m_format.encoding);
+
+    switch (m_format.encoding) {
+    case USpeakNative::PcmEncoding::UInt8:
+        Downmix(src, out, channels, sampleBytes, [](const std::byte* p) {
+            return (static_cast<float>(std::to_integer<std::uint8_t>(*p)) - 128.f) * (1.f / 128.f);
+        });
+        break;
+    case USpeakNative::PcmEncoding::Int16:
+        Downmix(src, out, channels, sampleBytes, [](const std::byte* p) {
+            std::int16_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return static_cast<float>(value) * (1.f / 32768.f);
+        });
+        break;
+    case USpeakNative::PcmEncoding::Int24:
+        Downmix(src, out, channels, sampleBytes, [](const std::byte* p) {
+            std::uint32_t bits = std::to_integer<std::uint32_t>(p[0]) << 8 | std::to_integer<std::uint32_t>(p[1]) << 16 | std::to_integer<std::uint32_t>(p[2]) << 24;
+            return static_cast<float>(static_cast<std::int32_t>(bits) >> 8) * (1.f / 8388608.f);
+        });
+        break;
+    case USpeakNative::PcmEncoding::Int32:
+        Downmix(src, out, channels, sampleBytes, [](const std::byte* p) {
+            std::int32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return static_cast<float>(value) * (1.f / 2147483648.f);
+        });
+        break;
+    case USpeakNative::PcmEncoding::Float32:
+        Downmix(src, out, channels, sampleBytes, [](const std::byte* p) {
+            float value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        });
+        break;
+    case USpeakNative::PcmEncoding::Float64:
+        Downmix(src, out, channels, sampleBytes, [](const std::byte* p) {
+            double value;
+            std::memcpy(&value, p, sizeof(value));
+            return static_cast<float>(value);
+        });
+        break;
+    }
+
+    m_position += frames;
+
+    std::size_t consumed = m_position * m_frameBytes;
+    if (consumed - m_discarded >= PCMFILE_DISCARDSIZE) {
+        std::size_t base = static_cast<std::size_t>(m_samples.data() - m_file.data().data());
+        std::size_t begin = m_discarded - std::min(m_discarded, PCMFILE_DISCARDOVERLAP);
+        m_file.discard(base + begin, consumed - begin);
+        m_discarded = consumed;
+    }
+
+    return frames;
+}
+
+bool USpeakNative::PcmFileReader::setFormat(const PcmFormat& format, std::span<const std::byte> samples)
+{
+    std::size_t sampleBytes = SampleBytes(format.encoding);
+    if (sampleBytes == 0 || format.sampleRate <= 0 || format.channels <= 0) {
+        return false;
+    }
+
+    m_format = format;
+    m_frameBytes = sampleBytes * static_cast<std::size_t>(format.channels);
+    m_samples = samples.first(samples.size() / m_frameBytes * m_frameBytes);
+    m_position = 0;
+    m_discarded = 0;
+
+    m_file.adviseSequential();
+
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef USPEAK_USPEAKPCMFILE_H
+#define USPEAK_USPEAKPCMFILE_H
+
+#include "internal/mappedfile.h"
+
+#include <span>
+#include <cstdint>
+#include <string_view>
+
+namespace USpeakNative {
+
+// Little endian, interleaved sample layouts
+enum class PcmEncoding {
+    UInt8,
+    Int16,
+    Int24,
+    Int32,
+    Float32,
+    Float64,
+};
+
+struct PcmFormat {
+    USpeakNative::PcmEncoding encoding;
+    int sampleRate;
+    int channels;
+};
+
+// Reads WAV or headerless PCM straight out of a memory mapping, converting to mono float a block at a time.
+// Pages behind the read position are dropped again, so a clip of any length is never resident in full.
+class PcmFileReader
+{
+public:
+    PcmFileReader();
+
+    // Fails without printing anything if the file isn't a WAV this reader understands, so callers can fall back to a full decoder
+    bool openWav(std::string_view filename);
+    bool openRaw(std::string_view filename, const USpeakNative::PcmFormat& format);
+    void close();
+
+    const USpeakNative::PcmFormat& format() const noexcept;
+    std::size_t frameCount() const noexcept;
+    std::size_t remainingFrames() const noexcept;
+
+    // Converts the next sample frames to mono, returns how many were written, 0 at the end
+    std::size_t readMono(std::span<float> out) noexcept;
+private:
+    bool setFormat(const USpeakNative::PcmFormat& format, std::span<const std::byte> samples);
+
+    USpeakNative::Internal::MappedFile m_file;
+    std::span<const std::byte> m_samples;
+    USpeakNative::PcmFormat m_format;
+    std::size_t m_frameBytes;
+    std::size_t m_position;
+    std::size_t m_discarded;
+};
+
+}
+
+#endif // USPEAK_USPEAKPCMFILE_H
@@ -0,0 +1,163 @@
+#include "uspeakremux.h"
+
+#include "helpers.h"
+#include "uspeakpacketvalidator.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+bool USpeakNative::NextFrame(std::span<const std::byte> packet, std::size_t& offset, USpeakFrameRef& frameOut) noexcept
+{
+    if (offset >= packet.size()) {
+        return false;
+    }
+
+    std::size_t frameSize = USpeakNative::USpeakFrameContainer::ContainerSize(packet.subspan(offset));
+    if (frameSize == 0) {
+        return false;
+    }
+
+    frameOut.frameIndex = USpeakNative::Helpers::ConvertFromBytes<std::uint16_t>(packet.data(), offset);
+    frameOut.container = packet.subspan(offset, frameSize);
+    offset += frameSize;
+
+    return true;
+}
+
+bool USpeakNative::ParseFrames(std::span<const std::byte> packet, std::vector<USpeakFrameRef>& framesOut)
+{
+    framesOut.clear();
+
+    USpeakNative::PacketLayout layout;
+    if (!USpeakNative::ValidatePacket(packet, layout)) {
+        fmt::print("[USpeakNative] Remux: {} at offset {}!\n", USpeakNative::PacketErrorString(layout.error), layout.errorOffset);
+        return false;
+    }
+
+    framesOut.reserve(layout.frameCount);
+    for (std::size_t i = 0; i < layout.frameCount; i++) {
+        framesOut.push_back(USpeakFrameRef { layout.frameIndex(packet, i), layout.container(packet, i) });
+    }
+
+    return true;
+}
+
+bool USpeakNative::RewriteHeader(std::span<std::byte> packet, std::int32_t playerId, std::uint32_t packetTime) noexcept
+{
+    if (packet.size() < USPEAK_HEADERSIZE) {
+        return false;
+    }
+
+    USpeakNative::Helpers::ConvertToBytes<std::int32_t>(packet.data(), 0, playerId);
+    USpeakNative::Helpers::ConvertToBytes<std::uint32_t>(packet.data(), 4, packetTime);
+
+    return true;
+}
+
+bool USpeakNative::RenumberFrames(std::span<std::byte> packet, std::uint16_t& frameIndex) noexcept
+{
+    if (packet.size() < USPEAK_HEADERSIZE) {
+        return false;
+    }
+
+    // Validate everything before touching anything, so a malformed packet is left as is
+    std::size_t offset = USPEAK_HEADERSIZE;
+    USpeakFrameRef frame;
+    while (offset < packet.size()) {
+        if (!NextFrame(packet, offset, frame)) {
+            return false;
+        }
+    }
+
+    offset = USPEAK_HEADERSIZE;
+    while (offset < packet.size()) {
+        NextFrame(packet, offset, frame);
+        USpeakNative::Helpers::ConvertToBytes<std::uint16_t>(packet.data(), offset - frame.container.size(), frameIndex++);
+    }
+
+    return true;
+}
+
+std::size_t USpeakNative::WritePacket(std::span<std::byte> packetOut, std::int32_t playerId, std::uint32_t packetTime, std::span<const USpeakFrameRef> frames) noexcept
+{
+    if (!RewriteHeader(packetOut, playerId, packetTime)) {
+        return 0;
+    }
+
+    std::size_t sizeWritten = USPEAK_HEADERSIZE;
+
+    for (const USpeakFrameRef& frame : frames) {
+        if (sizeWritten + frame.container.size() > packetOut.size()) {
+            return 0;
+        }
+
+        std::memcpy(packetOut.data() + sizeWritten, frame.container.data(), frame.container.size());
+        sizeWritten += frame.container.size();
+    }
+
+    return sizeWritten;
+}
+
+std::size_t USpeakNative::MergePackets(std::span<std::byte> packetOut, std::int32_t playerId, std::uint32_t packetTime, std::span<const std::span<const std::byte>> packets) noexcept
+{
+    if (!RewriteHeader(packetOut, playerId, packetTime)) {
+        return 0;
+    }
+
+    // Receivers reject anything the validator doesn't accept, so a larger output buffer doesn't allow a larger packet
+    std::size_t sizeLimit = std::min(packetOut.size(), USPEAK_BUFFERSIZE);
+    std::size_t sizeWritten = USPEAK_HEADERSIZE;
+
+    for (std::span<const std::byte> packet : packets) {
+        if (packet.size() < USPEAK_HEADERSIZE) {
+            return 0;
+        }
+
+        // Frames are stored back to back, so the whole body can be copied at once
+        std::span<const std::byte> body = packet.subspan(USPEAK_HEADERSIZE);
+        if (sizeWritten + body.size() > sizeLimit) {
+            return 0;
+        }
+
+        std::memcpy(packetOut.data() + sizeWritten, body.data(), body.size());
+        sizeWritten += body.size();
+    }
+
+    // The bodies were copied unparsed, check the result against the same limits, frame count included
+    USpeakNative::PacketLayout layout;
+    if (!USpeakNative::ValidatePacket(packetOut.first(sizeWritten), layout)) {
+        return 0;
+    }
+
+    return sizeWritten;
+}
+
+bool USpeakNative::SplitPacket(std::span<const std::byte> packet, std::size_t framesPerPacket, std::vector<std::vector<std::byte>>& packetsOut)
+{
+    packetsOut.clear();
+
+    if (framesPerPacket == 0) {
+        return false;
+    }
+
+    std::vector<USpeakFrameRef> frames;
+    if (!ParseFrames(packet, frames)) {
+        return false;
+    }
+
+    std::span<const USpeakFrameRef> remaining = frames;
+    while (!remaining.empty()) {
+        std::span<const USpeakFrameRef> chunk = remaining.first(std::min(framesPerPacket, remaining.size()));
+        remaining = remaining.subspan(chunk.size());
+
+        // Chunk frames are contiguous in the source packet
+        const std::byte* begin = chunk.front().container.data();
+        const std::byte* end = chunk.back().container.data() + chunk.back().container.size();
+
+        std::vector<std::byte>& out = packetsOut.emplace_back(USPEAK_HEADERSIZE + static_cast<std::size_t>(end - begin));
+        std::memcpy(out.data(), packet.data(), USPEAK_HEADERSIZE);
+        std::memcpy(out.data() + USPEAK_HEADERSIZE, begin, static_cast<std::size_t>(end - begin));
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef USPEAK_USPEAKREMUX_H
+#define USPEAK_USPEAKREMUX_H
+
+#include "uspeakpacket.h"
+#include "uspeakframecontainer.h"
+
+#include <span>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+namespace USpeakNative {
+
+// A view of one frame container inside a packet, header included
+struct USpeakFrameRef {
+    std::uint16_t frameIndex;
+    std::span<const std::byte> container;
+};
+
+bool NextFrame(std::span<const std::byte> packet, std::size_t& offset, USpeakFrameRef& frameOut) noexcept;
+bool ParseFrames(std::span<const std::byte> packet, std::vector<USpeakFrameRef>& framesOut);
+
+bool RewriteHeader(std::span<std::byte> packet, std::int32_t playerId, std::uint32_t packetTime) noexcept;
+bool RenumberFrames(std::span<std::byte> packet, std::uint16_t& frameIndex) noexcept;
+
+std::size_t WritePacket(std::span<std::byte> packetOut, std::int32_t playerId, std::uint32_t packetTime, std::span<const USpeakFrameRef> frames) noexcept;
+// Concatenates the frames of every packet behind a new header, returns bytes written or 0 if the result would not pass ValidatePacket
+std::size_t MergePackets(std::span<std::byte> packetOut, std::int32_t playerId, std::uint32_t packetTime, std::span<const std::span<const std::byte>> packets) noexcept;
+bool SplitPacket(std::span<const std::byte> packet, std::size_t framesPerPacket, std::vector<std::vector<std::byte>>& packetsOut);
+
+// Copies the header and every frame for which predicate(const USpeakFrameRef&) returns true, returns bytes written or 0 on failure
+template <typename Predicate>
+std::size_t FilterFrames(std::span<const std::byte> packetIn, std::span<std::byte> packetOut, Predicate predicate) noexcept {
+    if (packetIn.size() < USPEAK_HEADERSIZE || packetOut.size() < USPEAK_HEADERSIZE) {
+        return 0;
+    }
+
+    std::memcpy(packetOut.data(), packetIn.data(), USPEAK_HEADERSIZE);
+
+    std::size_t sizeWritten = USPEAK_HEADERSIZE;
+    std::size_t offset = USPEAK_HEADERSIZE;
+
+    USpeakFrameRef frame;
+    while (offset < packetIn.size()) {
+        if (!NextFrame(packetIn, offset, frame)) {
+            return 0;
+        }
+        if (!predicate(static_cast<const USpeakFrameRef&>(frame))) {
+            continue;
+        }
+        if (sizeWritten + frame.container.size() > packetOut.size()) {
+            return 0;
+        }
+
+        std::memcpy(packetOut.data() + sizeWritten, frame.container.data(), frame.container.size());
+        sizeWritten += frame.container.size();
+    }
+
+    return sizeWritten;
+}
+
+}
+
+#endif // USPEAK_USPEAKREMUX_H
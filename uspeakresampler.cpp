@@ -35,3 +35,42 @@ void USpeakNative::Resample(std::span<const float> src, int srcSampleRate, std::
         dst.push_back(static_cast<float>(sample));
     }
 }
+
+USpeakNative::StreamResampler::StreamResampler(double srcSampleRate, double dstSampleRate)
+    : m_ratio(1.)
+    , m_phase(0.)
+    , m_history()
+{
+    setRates(srcSampleRate, dstSampleRate);
+    reset();
+}
+
+void USpeakNative::StreamResampler::reset() noexcept
+{
+    m_phase = 0.;
+    m_history[0] = m_history[1] = m_history[2] = m_history[3] = 0.;
+}
+
+void USpeakNative::StreamResampler::setRates(double srcSampleRate, double dstSampleRate) noexcept
+{
+    setRatio(srcSampleRate / dstSampleRate);
+}
+
+void USpeakNative::StreamResampler::setRatio(double ratio) noexcept
+{
+    // A non positive ratio would never advance the read position
+    if (ratio > 0.) {
+        m_ratio = ratio;
+    }
+}
+
+double USpeakNative::StreamResampler::ratio() const noexcept
+{
+    return m_ratio;
+}
+
+float USpeakNative::StreamResampler::interpolate(double x) const noexcept
+{
+    double y[4] = { m_history[0], m_history[1], m_history[2], m_history[3] };
+    return static_cast<float>(sample_hermite_4p_3o(x, y));
+}
@@ -9,6 +9,40 @@ namespace USpeakNative {
 
 void Resample(std::span<const float> src, int srcSampleRate, std::vector<float>& dst, int dstSampleRate);
 
+// Cubic hermite resampler that keeps its state between calls, so input can arrive in chunks of any size
+class StreamResampler
+{
+public:
+    StreamResampler(double srcSampleRate = 48000., double dstSampleRate = 48000.);
+
+    void reset() noexcept;
+    void setRates(double srcSampleRate, double dstSampleRate) noexcept;
+    void setRatio(double ratio) noexcept;
+    double ratio() const noexcept;
+
+    template <typename Sink>
+    void process(std::span<const float> src, Sink&& sink) {
+        for (float sample : src) {
+            m_history[0] = m_history[1];
+            m_history[1] = m_history[2];
+            m_history[2] = m_history[3];
+            m_history[3] = sample;
+
+            while (m_phase < 1.) {
+                sink(interpolate(m_phase));
+                m_phase += m_ratio;
+            }
+            m_phase -= 1.;
+        }
+    }
+private:
+    float interpolate(double x) const noexcept;
+
+    double m_ratio;
+    double m_phase;
+    double m_history[4];
+};
+
 }
 
 #endif // USPEAK_RESAMPLER_H
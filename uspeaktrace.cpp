@@ -0,0 +1,239 @@
+#include "uspeaktrace.h"
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+constexpr std::size_t TRACE_THREADCAPACITY = 1 << 16;
+// Buffers are recycled once their thread exits, this only bounds how many threads can trace at the same time
+constexpr std::size_t TRACE_MAXBUFFERS = 64;
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    std::int64_t startNs;
+    std::int64_t durationNs;
+    std::int32_t playerId;
+    std::int32_t frameIndex;
+};
+
+// Written only by its own thread, the count is published with release so a flush sees complete events
+struct ThreadBuffer {
+    ThreadBuffer(std::uint32_t threadId)
+        : threadId(threadId)
+        , count(0)
+        , dropped(0)
+        , leased(true)
+        , events(TRACE_THREADCAPACITY)
+    {
+    }
+
+    std::uint32_t threadId;
+    std::atomic<std::size_t> count;
+    std::atomic<std::uint64_t> dropped;
+    bool leased; // Guarded by the registry mutex
+    std::vector<TraceEvent> events;
+};
+
+struct TraceRegistry {
+    std::atomic_bool enabled { false };
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    // Buffers are owned here so events outlive the threads that recorded them
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    // Events from threads that couldn't get a buffer
+    std::atomic<std::uint64_t> unbuffered { 0 };
+};
+
+TraceRegistry& GetRegistry()
+{
+    static TraceRegistry registry;
+    return registry;
+}
+
+// Hands the buffer back when its thread exits, the events stay and the next thread to lease it appends after them
+struct BufferLease {
+    ~BufferLease()
+    {
+        if (buffer == nullptr) {
+            return;
+        }
+        try {
+            std::lock_guard<std::mutex> l(GetRegistry().mutex);
+            buffer->leased = false;
+        } catch (...) {
+            // The buffer just stays leased
+        }
+    }
+
+    ThreadBuffer* buffer = nullptr;
+};
+
+thread_local BufferLease t_lease;
+
+// Only called when an event starts, so the destructor that records it never locks or allocates
+ThreadBuffer* AcquireThreadBuffer() noexcept
+{
+    if (t_lease.buffer != nullptr) {
+        return t_lease.buffer;
+    }
+
+    try {
+        TraceRegistry& registry = GetRegistry();
+        std::lock_guard<std::mutex> l(registry.mutex);
+
+        for (auto& buffer : registry.buffers) {
+            if (!buffer->leased) {
+                buffer->leased = true;
+                t_lease.buffer = buffer.get();
+                return t_lease.buffer;
+            }
+        }
+
+        if (registry.buffers.size() < TRACE_MAXBUFFERS) {
+            registry.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<std::uint32_t>(registry.buffers.size() + 1)));
+            t_lease.buffer = registry.buffers.back().get();
+        }
+    } catch (...) {
+        // Out of memory or a failed lock, the event is dropped
+    }
+
+    return t_lease.buffer;
+}
+
+std::int64_t NowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetRegistry().epoch).count();
+}
+
+}
+
+void USpeakNative::Trace::Enable(bool enabled) noexcept
+{
+    GetRegistry().enabled.store(enabled, std::memory_order::relaxed);
+}
+
+bool USpeakNative::Trace::Enabled() noexcept
+{
+    return GetRegistry().enabled.load(std::memory_order::relaxed);
+}
+
+void USpeakNative::Trace::Clear()
+{
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> l(registry.mutex);
+    for (auto& buffer : registry.buffers) {
+        buffer->count.store(0, std::memory_order::relaxed);
+        buffer->dropped.store(0, std::memory_order::relaxed);
+    }
+    registry.unbuffered.store(0, std::memory_order::relaxed);
+}
+
+std::uint64_t USpeakNative::Trace::DroppedEvents()
+{
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> l(registry.mutex);
+
+    std::uint64_t dropped = registry.unbuffered.load(std::memory_order::relaxed);
+    for (auto& buffer : registry.buffers) {
+        dropped += buffer->dropped.load(std::memory_order::relaxed);
+    }
+    return dropped;
+}
+
+bool USpeakNative::Trace::WriteChromeTrace(std::string_view filename)
+{
+    std::string path(filename);
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fmt::print("[USpeakNative] Trace: Failed to open {}!\n", filename);
+        return false;
+    }
+
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> l(registry.mutex);
+
+    fmt::print(file, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    for (auto& buffer : registry.buffers) {
+        std::size_t count = buffer->count.load(std::memory_order::acquire);
+        for (std::size_t i = 0; i < count; i++) {
+            const TraceEvent& event = buffer->events[i];
+
+            // Complete events, timestamps in fractional microseconds
+            fmt::print(file, "{}\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{",
+                       first ? "" : ",", event.name, buffer->threadId, static_cast<double>(event.startNs) / 1000., static_cast<double>(event.durationNs) / 1000.);
+            if (event.playerId >= 0) {
+                fmt::print(file, "\"playerId\":{}", event.playerId);
+            }
+            if (event.frameIndex >= 0) {
+                fmt::print(file, "{}\"frameIndex\":{}", event.playerId >= 0 ? "," : "", event.frameIndex);
+            }
+            fmt::print(file, "}}}}");
+            first = false;
+        }
+    }
+    fmt::print(file, "\n]}}\n");
+
+    bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+}
+
+USpeakNative::Trace::ScopedEvent::ScopedEvent(const char* name, std::int32_t playerId, std::int32_t frameIndex) noexcept
+    : m_name(Enabled() ? name : nullptr)
+    , m_startNs(0)
+    , m_playerId(playerId)
+    , m_frameIndex(frameIndex)
+{
+    if (m_name == nullptr) {
+        return;
+    }
+
+    if (AcquireThreadBuffer() == nullptr) {
+        GetRegistry().unbuffered.fetch_add(1, std::memory_order::relaxed);
+        m_name = nullptr;
+        return;
+    }
+
+    m_startNs = NowNs();
+}
+
+USpeakNative::Trace::ScopedEvent::~ScopedEvent()
+{
+    if (m_name == nullptr) {
+        return;
+    }
+
+    std::int64_t endNs = NowNs();
+
+    // The constructor leased the buffer on this same thread
+    ThreadBuffer& buffer = *t_lease.buffer;
+    std::size_t index = buffer.count.load(std::memory_order::relaxed);
+    if (index >= buffer.events.size()) {
+        buffer.dropped.fetch_add(1, std::memory_order::relaxed);
+        return;
+    }
+
+    buffer.events[index] = TraceEvent { m_name, m_startNs, endNs - m_startNs, m_playerId, m_frameIndex };
+    buffer.count.store(index + 1, std::memory_order::release);
+}
+
+void USpeakNative::Trace::ScopedEvent::setPlayerId(std::int32_t playerId) noexcept
+{
+    m_playerId = playerId;
+}
+
+void USpeakNative::Trace::ScopedEvent::setFrameIndex(std::int32_t frameIndex) noexcept
+{
+    m_frameIndex = frameIndex;
+}
@@ -0,0 +1,40 @@
+#ifndef USPEAK_USPEAKTRACE_H
+#define USPEAK_USPEAKTRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+namespace USpeakNative::Trace {
+
+// Tracing is off by default, a disabled ScopedEvent costs one relaxed atomic load
+void Enable(bool enabled) noexcept;
+bool Enabled() noexcept;
+
+// Every thread records into its own fixed size buffer with no locking, events past the capacity are counted and dropped.
+// A thread leases its buffer on its first event and hands it back when it exits, the number of buffers is bounded.
+// Only call Clear while tracing is disabled and no traced code is running.
+void Clear();
+std::uint64_t DroppedEvents();
+
+// Chrome trace-event JSON, opens in chrome://tracing and ui.perfetto.dev
+bool WriteChromeTrace(std::string_view filename);
+
+struct ScopedEvent {
+    ScopedEvent(const char* name, std::int32_t playerId = -1, std::int32_t frameIndex = -1) noexcept;
+    ScopedEvent(const ScopedEvent&) = delete;
+    ScopedEvent& operator=(const ScopedEvent&) = delete;
+    ~ScopedEvent();
+
+    void setPlayerId(std::int32_t playerId) noexcept;
+    void setFrameIndex(std::int32_t frameIndex) noexcept;
+private:
+    const char* m_name;
+    std::int64_t m_startNs;
+    std::int32_t m_playerId;
+    std::int32_t m_frameIndex;
+};
+
+}
+
+#endif // USPEAK_USPEAKTRACE_H
@@ -8,29 +8,38 @@ float USpeakNative::GetRMS(std::span<const float> samples) noexcept
     for (float sample : samples)
         sum += sample * sample;
 
-    return std::sqrtf(sum / static_cast<float>(samples.size()));
+    return std::sqrt(sum / static_cast<float>(samples.size()));
 }
 void USpeakNative::AutoLevel(std::span<float> samples, float rms, float rmsTarget, float& currentScale, float& runningScale) noexcept
 {
-    float halfLength = static_cast<float>(samples.size()) / 0.5f;
+    float fromScale, toScale;
+    AutoLevelStep(rms, rmsTarget, currentScale, runningScale, fromScale, toScale);
+    ApplyGainRamp(samples, fromScale, toScale);
+}
+void USpeakNative::AutoLevelStep(float rms, float rmsTarget, float& currentScale, float& runningScale, float& fromScale, float& toScale) noexcept
+{
+    // Written without branches on the state so a batch of players can be stepped in one vectorizable loop
+    bool quiet = rms <= rmsTarget;
+    float rmsRatio = quiet ? 1.f : rmsTarget / rms;
+    float quietRunning = (runningScale * 0.9975f) + 0.0025f;
+    bool ramp = !quiet || currentScale < 1.f || quietRunning < 1.f;
 
-    if (rms <= rmsTarget) {
-        runningScale = (runningScale * 0.9975f) + 0.0025f;
-        if (currentScale < 1.f || runningScale < 1.f) {
-            for (std::size_t i = 0; i < samples.size(); i++) {
-                samples[i] *= std::lerp(currentScale, runningScale, static_cast<float>(i) / halfLength);
-            }
-            currentScale = runningScale;
-        }
-    } else {
-        float rmsRatio = rmsTarget / rms;
+    fromScale = ramp ? currentScale : 1.f;
+    toScale = ramp ? (quiet ? quietRunning : rmsRatio) : 1.f;
 
-        for (std::size_t i = 0; i < samples.size();) {
-            samples[i] *= std::lerp(currentScale, rmsRatio, static_cast<float>(i) / halfLength);
-        }
+    currentScale = ramp ? toScale : currentScale;
+    runningScale = quiet ? quietRunning : (rmsRatio * 0.5f) + (runningScale * 0.95f);
+}
+void USpeakNative::ApplyGainRamp(std::span<float> samples, float fromScale, float toScale) noexcept
+{
+    if (fromScale == 1.f && toScale == 1.f) {
+        return;
+    }
 
-        currentScale = rmsRatio;
-        runningScale = (rmsRatio * 0.5f) + (runningScale * 0.95f);
+    float halfLength = static_cast<float>(samples.size()) / 0.5f;
+
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        samples[i] *= std::lerp(fromScale, toScale, static_cast<float>(i) / halfLength);
     }
 }
 void USpeakNative::ApplyGain(std::span<float> samples, float gain) noexcept
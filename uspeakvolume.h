@@ -7,6 +7,8 @@ namespace USpeakNative {
 
 float GetRMS(std::span<const float> samples) noexcept;
 void AutoLevel(std::span<float> samples, float rms, float rmsTarget, float& currentScale, float& runningScale) noexcept;
+void AutoLevelStep(float rms, float rmsTarget, float& currentScale, float& runningScale, float& fromScale, float& toScale) noexcept;
+void ApplyGainRamp(std::span<float> samples, float fromScale, float toScale) noexcept;
 void ApplyGain(std::span<float> samples, float gain) noexcept;
 void NormalizeGain(std::span<float> samples) noexcept;
 